@@ -26,30 +26,95 @@ POLY=0      # Compute polynomial coefficients
 SWAP=0      # Swaps-for-free
 BEAT=0      # Heart-beat every BEAT seconds
 MAX=34      # max table size 2^MAX
+GROW=1      # grow hash-tables online
+COMPACT=0   # compact hash-tables
+SWISS=0     # hash-tables with SIMD tag groups
+FREEZE=0    # freeze completed levels
+ORDERED=0   # order clusters of completed levels
+FILTER=0    # bits per key of Bloom filters for completed levels
+ARENA=0     # recycle table memory, with huge pages and pre-faulting
+SHARDS=1    # level tables split into shards
+NUMA=0      # NUMA placement of table memory
+CACHE=0     # per-thread cache of canonical forms
+GLOBAL=0    # single visited table for all levels
+BATCH=16    # frontier elements expanded together
+KERNEL=1    # bit-matrix kernels, selected at run time
+SIMD=1      # successors normalized together in SIMD lanes
+LOOKUP=0    # table of all canonical forms, for N<=5
+PRUNE=1     # one move per orbit of the automorphisms
+INVERSE=0   # forward search also up to inverse and transpose
+ORDERLY=0   # generate matrices only from their canonical parent
+BACK=0      # skip the moves back into the previous level
+DENSE=0     # BFS over all ranked matrices, for N<=6
+ARCH=native # target architecture of the binary
 
-while getopts B:D:E:M:N:P:Q:S:T:h flag
+while getopts A:B:C:D:E:F:G:H:I:J:K:L:M:N:O:P:Q:R:S:T:U:V:W:X:Y:Z:p:i:o:b:d:h flag
 do
     case "${flag}" in
+        A) BATCH=${OPTARG};;
         B) BEAT=${OPTARG};;
+        C) COMPACT=${OPTARG};;
         D) DIST=${OPTARG};;
         E) EXTRA=${OPTARG};;
+        F) FREEZE=${OPTARG};;
+        G) GROW=${OPTARG};;
+        H) ARENA=${OPTARG};;
+        I) CACHE=${OPTARG};;
+        J) KERNEL=${OPTARG};;
+        K) export OMP_PLACES=${OPTARG}; export OMP_PROC_BIND=spread;;
+        L) FILTER=${OPTARG};;
         M) MAX=${OPTARG};;
         N) NAUTY=${OPTARG};;
+        O) ORDERED=${OPTARG};;
         P) POLY=${OPTARG};;
         Q) QUBITS=${OPTARG};;
+        R) SHARDS=${OPTARG};;
         S) SWAP=${OPTARG};;
+        V) GLOBAL=${OPTARG};;
+        W) SWISS=${OPTARG};;
+        X) ARCH=${OPTARG};;
+        Y) SIMD=${OPTARG};;
+        Z) LOOKUP=${OPTARG};;
+        p) PRUNE=${OPTARG};;
+        i) INVERSE=${OPTARG};;
+        o) ORDERLY=${OPTARG};;
+        b) BACK=${OPTARG};;
+        d) DENSE=${OPTARG};;
         T) export OMP_NUM_THREADS=${OPTARG};;
+        U) NUMA=${OPTARG};;
         h) echo "Usage: matrix_cnot.sh [options] [goal]: optimal CNOT synthesis" 
            echo
            echo "Compile-time Options:"
+           echo "  -A batch   : expand frontier in blocks of BATCH, prefetching buckets (0=no batches) (default $BATCH)"
            echo "  -B beat    : heart-beat every BEAT seconds (0=no beat) (default $BEAT)"
+           echo "  -C compact : compact hash-tables, storing only remainders (0 no, 1 yes) (default $COMPACT)"
            echo "  -E extra   : size of hash-tables for levels + EXTRA bits (default $EXTRA)"
+           echo "  -F freeze  : freeze completed levels into succinct sorted sets (0 no, 1 yes) (default $FREEZE)"
+           echo "  -G grow    : grow hash-tables online, starting small (0 no, 1 yes) (default $GROW)"
+           echo "  -H arena   : recycle table memory across levels, with huge pages and parallel pre-faulting (0 no, 1 yes) (default $ARENA)"
+           echo "  -I cache   : per-thread cache of 2^CACHE canonical forms (0=no cache) (default $CACHE)"
+           echo "  -J kernel  : bit-matrix kernels for permutations, GFNI/BMI2 if the CPU has them (0 no, 1 yes) (default $KERNEL)"
+           echo "  -K places  : pin OpenMP threads to PLACES (threads, cores or sockets), spread over them (default: not pinned)"
+           echo "  -L filter  : bits per key of Bloom filters for completed levels (0=no filter) (default $FILTER)"
            echo "  -M max     : max table size 2^MAX (default $MAX)"
-           echo "  -N nauty   : using Nauty (0 no, 1 yes) (default $NAUTY)"
+           echo "  -N nauty   : using Nauty (0 no, 1 yes, 2 only for large finger-print cells) (default $NAUTY)"
+           echo "  -O ordered : sort clusters of completed levels by home bucket, to stop lookups early (0 no, 1 yes) (default $ORDERED)"
            echo "  -P poly    : compute polynomial coefficients (0 no, 1 yes) (default $POLY)"
            echo "  -Q qubits  : number of Qubits (default $QUBITS)"
-           echo "  -S swap    : swaps-are-for-free, requires nauty (0 no, 1 yes) (default $SWAP)"
+           echo "  -R shards  : split level tables into SHARDS (power of 2) tables, each of max-size 2^MAX (default $SHARDS)"
+           echo "  -S swap    : swaps-are-for-free, with nauty only if NAUTY=1 (0 no, 1 yes) (default $SWAP)"
            echo "  -T threads : number of OpenMP threads to use (\"\" is all cores) (default \"$OMP_NUM_THREADS\")"
+           echo "  -U numa    : memory placement (0 first touch, 1 shards on NUMA nodes, 2 interleave) (default $NUMA)"
+           echo "  -V visited : single visited table for all levels, tagged with depth (0 no, 1 yes) (default $GLOBAL)"
+           echo "  -W swiss   : hash-tables matching groups of 7-bit tags with SIMD (0 no, 1 yes) (default $SWISS)"
+           echo "  -X arch    : target architecture of the binary, e.g. x86-64-v2 for mixed clusters (default $ARCH)"
+           echo "  -Y simd    : normalize the successors of a matrix together in SIMD lanes, with permutations (0 no, 1 yes) (default $SIMD)"
+           echo "  -Z lookup  : table of the canonical forms of all matrices, N<=5 without SWAP (0 no, 1 built at startup, 2 also kept in a file) (default $LOOKUP)"
+           echo "  -p prune   : expand one move per orbit of the automorphisms of a matrix, without SWAP (0 no, 1 yes) (default $PRUNE)"
+           echo "  -i inverse : quotient the forward search also by inverse transpose, or by inverse and transpose, without SWAP (0 no, 1 inverse transpose, 2 both) (default $INVERSE)"
+           echo "  -o orderly : generate a matrix only from its canonical parent, without deduplication in the next level (0 no, 1 yes) (default $ORDERLY)"
+           echo "  -b back    : skip the moves back into the previous level, marked in the level tables, with SIMD=1 and separate uncompressed tables (0 no, 1 yes) (default $BACK)"
+           echo "  -d dense   : BFS over all matrices without symmetries, 2 bits each, top-down or bottom-up per level, N<=6 without SWAP, POLY or goal (0 no, 1 yes) (default $DENSE)"
            echo "  -h         : this help"
            echo
            echo "Run-time Options:"
@@ -63,23 +128,40 @@ do
     esac
 done
 
+if [ $GLOBAL -eq 1 ] && [ $GROW -eq 0 ]; then
+    echo "Growing tables switched on: required by a single visited table"
+    GROW=1
+fi
+
 if [ $SWAP -eq 1 ] && [ $POLY -eq 1 ]; then
     echo "Polynomial coefficients switched off: not supported with SWAP"
     POLY=0
 fi
 
-if [ $SWAP -eq 1 ] && [ $NAUTY -eq 0 ]; then
-    echo "Nauty switched on: SWAP is only supported with Nauty"
-    NAUTY=1
+if [ $SWAP -eq 1 ] && [ $NAUTY -eq 2 ]; then
+    echo "Nauty switched off: SWAP is not supported with NAUTY=2"
+    NAUTY=0
 fi
 
-# Setting compile-time options
+if [ $LOOKUP -ge 1 ] && ([ $QUBITS -gt 5 ] || [ $SWAP -eq 1 ]); then
+    echo "Lookup table switched off: only supported for N<=5 without SWAP"
+    LOOKUP=0
+fi
 
-exec=matrix_cnot${QUBITS}.exe
-opts="-DN=$QUBITS -DE=$EXTRA -DMAX=$MAX -DPOLY=$POLY -DNAUTY=$NAUTY -DSWAP=$SWAP -DBEAT=$BEAT"
-args="-fopenmp -O3 -DNDEBUG -march=native -std=c++17"
-if [ $NAUTY -eq 1 ]; then
-    nauty_args="-I./nauty nauty/nautyW1.a -DWORDSIZE=32 -DMAXN=WORDSIZE"
+if [ $INVERSE -ge 1 ] && [ $SWAP -eq 1 ]; then
+    echo "Inverse symmetry switched off: not supported with SWAP"
+    INVERSE=0
+fi
+
+if [ $BACK -eq 1 ] && ([ $QUBITS -gt 7 ] || [ $SWAP -eq 1 ] || [ $NAUTY -eq 1 ] || [ $SIMD -eq 0 ] || [ $LOOKUP -ge 1 ] || [ $INVERSE -ge 1 ] || [ $ORDERLY -eq 1 ] || \
+                        [ $GLOBAL -eq 1 ] || [ $COMPACT -eq 1 ] || [ $SWISS -eq 1 ] || [ $FREEZE -eq 1 ] || [ $ORDERED -eq 1 ] || [ $FILTER -gt 0 ]); then
+    echo "Back moves switched off: only supported for N<=7 with SIMD=1, without SWAP, NAUTY=1, LOOKUP, INVERSE, ORDERLY, GLOBAL, COMPACT, SWISS, FREEZE, ORDERED or FILTER"
+    BACK=0
+fi
+
+if [ $DENSE -eq 1 ] && ([ $QUBITS -gt 6 ] || [ $SWAP -eq 1 ] || [ $POLY -eq 1 ]); then
+    echo "Dense BFS switched off: only supported for N<=6 without SWAP or POLY"
+    DENSE=0
 fi
 
 # Setting run-time options
@@ -92,6 +174,20 @@ if [ "$goal" != "" ] && [ $POLY -eq 1 ]; then
     POLY=0
 fi
 
+if [ "$goal" != "" ] && [ $DENSE -eq 1 ]; then
+    echo "Dense BFS switched off: not supported with GOAL"
+    DENSE=0
+fi
+
+# Setting compile-time options
+
+exec=matrix_cnot${QUBITS}.exe
+opts="-DN=$QUBITS -DE=$EXTRA -DMAX=$MAX -DGROW=$GROW -DCOMPACT=$COMPACT -DSWISS=$SWISS -DFREEZE=$FREEZE -DORDERED=$ORDERED -DFILTER=$FILTER -DARENA=$ARENA -DSHARDS=$SHARDS -DNUMA=$NUMA -DCACHE=$CACHE -DKERNEL=$KERNEL -DSIMD=$SIMD -DLOOKUP=$LOOKUP -DPRUNE=$PRUNE -DINVERSE=$INVERSE -DORDERLY=$ORDERLY -DBACK=$BACK -DDENSE=$DENSE -DGLOBAL=$GLOBAL -DBATCH=$BATCH -DPOLY=$POLY -DNAUTY=$NAUTY -DSWAP=$SWAP -DBEAT=$BEAT"
+args="-fopenmp -O3 -DNDEBUG -march=$ARCH -std=c++17"
+if [ $NAUTY -ge 1 ]; then
+    nauty_args="-I./nauty nauty/nautyW1.a -DWORDSIZE=32 -DMAXN=WORDSIZE"
+fi
+
 \rm -f $exec
 set -x
 g++ -o $exec src/matrix_cnot.cpp $opts $args $nauty_args
@@ -0,0 +1,213 @@
+/*
+ * Jaco van de Pol, Aarhus University, 2025
+ *
+ * Arena: the memory of all hash tables is mapped and unmapped through the arena.
+ *
+ * By default, the arena simply calls mmap and munmap. When enabled, it keeps
+ * the mappings of released tables, and hands them out again to new tables of
+ * the same or a somewhat smaller size (best fit), so a new level does not pay
+ * again for its page faults.
+ * Fresh mappings are backed by huge pages: from hugetlbfs if pages are reserved,
+ * and otherwise aligned to 2MB and advised to use transparent huge pages.
+ * A table must start zeroed: outside parallel regions, all OpenMP threads clear
+ * (and thereby pre-fault) the mapping. Inside a parallel region (a growing table)
+ * the pages are left to be faulted lazily by the threads that touch them, and a
+ * recycled mapping is cleared with MADV_DONTNEED instead.
+ * The arena never keeps more memory mapped than the largest amount that was in
+ * use at any time; on a miss, cached mappings are released (smallest first).
+ *
+ * On NUMA machines, the arena also places the memory: a table can ask for its
+ * pages on a given node (the shards of a ShardedHashSet are spread over the
+ * nodes), or all tables can be interleaved over all nodes. Otherwise, pages
+ * land on the node of the thread that happens to touch them first.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <omp.h>
+
+class Arena {
+public:
+    static constexpr size_t HUGE = 2ULL << 20; // size of a huge page
+    static constexpr size_t FIT = 4; // a table may reuse a mapping up to FIT times its size
+    static constexpr int ANY = -1; // memory placed by first touch (or interleaved)
+    static constexpr int INTERLEAVE = -2;
+
+    enum Placement { FIRST_TOUCH = 0, ON_NODES = 1, INTERLEAVED = 2 }; // see NUMA in options.h
+
+    Arena(): _enabled(false), _placement(FIRST_TOUCH), _inUse(0), _cached(0), _peak(0), _nanos(0), _recycled(0) {}
+
+    void enable(bool on) { _enabled = on; }
+
+    bool enabled() const { return _enabled; }
+
+    void place(Placement placement) { _placement = placement; }
+
+    // the number of NUMA nodes, from /sys (1 if unknown)
+    static int nodes() {
+        static int n = [] {
+            int lo = 0, hi = 0;
+            FILE* f = fopen("/sys/devices/system/node/online", "r");
+            if (f) {
+                if (fscanf(f, "%d-%d", &lo, &hi) < 2) hi = lo;
+                fclose(f);
+            }
+            return std::max(1, std::min(hi + 1, 64));
+        }();
+        return n;
+    }
+
+    // the node for shard i of a table
+    int node(size_t i) const {
+        return _placement == ON_NODES ? i % nodes() : ANY;
+    }
+
+    // zeroed memory of the given size on the given node, or nullptr if it cannot be mapped
+    void* map(size_t bytes, int node=ANY) {
+        node = policy(node);
+        if (!_enabled) {
+            void* p = plain(bytes);
+            if (p) bind(p, bytes, node);
+            return p;
+        }
+        auto start = std::chrono::steady_clock::now();
+        void* p = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = _free.lower_bound(Key(node, bytes)); // best fit, on the same node
+            if (it != _free.end() && it->first.first == node && it->first.second <= FIT * bytes) {
+                size_t size = it->first.second;
+                p = it->second;
+                _sizes[p] = size;
+                _cached -= size;
+                _inUse += size - bytes; // the rest of the mapping is not available
+                _free.erase(it);
+                _recycled += bytes;
+            } else {
+                _peak = std::max(_peak, _inUse + bytes);
+                while (!_free.empty() && _inUse + _cached + bytes > _peak) {
+                    auto smallest = std::min_element(_free.begin(), _free.end(),
+                        [](auto& a, auto& b) { return a.first.second < b.first.second; });
+                    munmap(smallest->second, smallest->first.second);
+                    _cached -= smallest->first.second;
+                    _free.erase(smallest);
+                }
+            }
+            _inUse += bytes;
+        }
+        if (p) clear(p, bytes); // a recycled mapping is already placed
+        else {
+            p = fresh(bytes);
+            if (p) bind(p, bytes, node); // before its pages are touched
+            if (p && !omp_in_parallel()) clear(p, bytes);
+        }
+        _nanos += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+        return p;
+    }
+
+    // keep the mapping for a next table of the same size, on the same node
+    void unmap(void* p, size_t bytes, int node=ANY) {
+        node = policy(node);
+        if (!_enabled) {
+            munmap(p, bytes);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _sizes.find(p);
+        if (it != _sizes.end()) { // a recycled mapping can be larger than the table
+            bytes = it->second;
+            _sizes.erase(it);
+        }
+        _free.emplace(Key(node, bytes), p);
+        _inUse -= bytes;
+        _cached += bytes;
+    }
+
+    // seconds spent in map() since the previous call
+    double takeSeconds() { return _nanos.exchange(0) * 1e-9; }
+
+    // bytes handed out again since the previous call
+    size_t takeRecycled() { return _recycled.exchange(0); }
+
+private:
+    using Key = std::pair<int,size_t>; // node and size of a mapping
+
+    static constexpr int MPOL_PREFERRED_ = 1; // from <numaif.h>, to avoid a dependency on libnuma
+    static constexpr int MPOL_INTERLEAVE_ = 3;
+
+    int policy(int node) const {
+        return node == ANY && _placement == INTERLEAVED ? INTERLEAVE : node;
+    }
+
+    // ask the kernel to put the pages of p on node (best effort)
+    static void bind(void* p, size_t bytes, int node) {
+#if defined(SYS_mbind)
+        if (node == ANY || nodes() < 2) return;
+        unsigned long mask = node == INTERLEAVE ? ~0UL >> (64 - nodes()) : 1UL << node;
+        int mode = node == INTERLEAVE ? MPOL_INTERLEAVE_ : MPOL_PREFERRED_;
+        syscall(SYS_mbind, p, bytes, mode, &mask, 8 * sizeof(mask), 0);
+#endif
+    }
+
+    static void* plain(size_t bytes) {
+        void* p = mmap(nullptr, bytes, PROT_READ|PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+
+    static void* fresh(size_t bytes) {
+        if (bytes < HUGE) return plain(bytes);
+#if defined(MAP_HUGETLB)
+        if (bytes % HUGE == 0) { // reserved up front: without a reservation, a fault could fail later
+            void* p = mmap(nullptr, bytes, PROT_READ|PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED) return p;
+        }
+#endif
+        // over-allocate, and trim to a 2MB aligned range, so it can be backed by huge pages
+        char* raw = (char*)plain(bytes + HUGE);
+        if (!raw) return nullptr;
+        char* p = (char*)(((uintptr_t)raw + HUGE - 1) & ~(uintptr_t)(HUGE - 1));
+        if (p > raw) munmap(raw, p - raw);
+        if (raw + HUGE > p) munmap(p + bytes, raw + HUGE - p);
+#if defined(MADV_HUGEPAGE)
+        madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+        return p;
+    }
+
+    // zero the memory; in parallel this also faults its pages in
+    static void clear(void* p, size_t bytes) {
+        char* c = (char*)p;
+        if (omp_in_parallel()) { // anonymous pages read as 0 again, or clear them here
+            if (madvise(p, bytes, MADV_DONTNEED) != 0) memset(c, 0, bytes);
+            return;
+        }
+        size_t chunks = (bytes + HUGE - 1) / HUGE;
+        #pragma omp parallel for schedule(static)
+        for (size_t i=0; i<chunks; i++)
+            memset(c + i * HUGE, 0, std::min(HUGE, bytes - i * HUGE));
+    }
+
+    bool _enabled;
+    Placement _placement;
+    std::mutex _mutex;
+    std::multimap<Key, void*> _free; // released mappings, by node and size
+    std::map<void*, size_t> _sizes; // size of recycled mappings in use
+    size_t _inUse;
+    size_t _cached;
+    size_t _peak;
+    std::atomic<uint64_t> _nanos;
+    std::atomic<size_t> _recycled;
+};
+
+inline Arena arena; // shared by all tables
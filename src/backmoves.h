@@ -0,0 +1,117 @@
+/*
+ * Jaco van de Pol, Aarhus University, 2025
+ *
+ * Back-move masks (BACK=1): every matrix in a level table carries the set of its
+ * moves that are known to lead back into the previous level.
+ *
+ * When the canonical y is reached from x by the move (i,j), then (i,j) relabelled by
+ * the canonical permutation is a move of y back to (a permutation of) x, since adding
+ * a row twice cancels. So every successor that is inserted into the next level, or
+ * found there already, marks its move back into the current level. When the next
+ * level is expanded, these moves are skipped: their successors would be canonicalized
+ * only to be found in prev.
+ * As with the depth tags of visited.h, the mask is stored in the bits above N*N of the
+ * bucket, which is in the cache after the probe anyway (a side array would cost another
+ * cache miss per successor). For N=6 only the first 28 of the 30 moves fit, for N=7
+ * the first 15 of 42. The other moves are never skipped, which only costs their
+ * canonicalization. With CACHE>0 the canonical labelling of a successor is cached
+ * with its automorphisms, so a cache hit still marks its move back.
+ * Since the buckets hold masks, the levels are separate tables of uncompressed keys
+ * that are never moved (no GLOBAL, COMPACT, SWISS, FREEZE, ORDERED or FILTER).
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <omp.h>
+#include "visited.h"
+#include "matrix.h"
+
+// A HashSet of keys with KEYBITS bits that carry a mask of moves in the remaining high bits.
+// Keys are hashed and compared without their mask, which only grows.
+template<size_t KEYBITS>
+class MaskedHashSet : public TaggedHashSet<KEYBITS> {
+public:
+    using Tagged = TaggedHashSet<KEYBITS>;
+    using TO_TYPE = typename Tagged::TO_TYPE;
+    using Tagged::insert;
+
+    // the moves that fit in a mask
+    static constexpr uint64_t MASKABLE = (1ULL << std::min<size_t>(MOVES, 64 - KEYBITS)) - 1;
+
+    // insert key with the mask bits, or add them to the mask of key if it is present
+    TO_TYPE insertOrMark(uint64_t key, uint64_t bits, bool &is_new) {
+        uint64_t tag = (bits & MASKABLE) << KEYBITS;
+        TO_TYPE e = this->template insertOrContains<1>(key | tag, is_new);
+        if (!is_new && tag && !this->moved(e)) {
+            // a failed exchange reloads the bucket; MOVED (all ones) already has every bit
+            std::atomic<uint64_t> &bucket = this->_map[e];
+            uint64_t word = bucket.load(std::memory_order_relaxed);
+            while ((word | tag) != word &&
+                   !bucket.compare_exchange_weak(word, word | tag, std::memory_order_relaxed)) {}
+        }
+        return e;
+    }
+
+    __attribute__((always_inline))
+    bool insert(uint64_t key, uint64_t bits) {
+        bool is_new;
+        insertOrMark(key, bits, is_new);
+        return is_new;
+    }
+
+    template<typename FUNC>
+    void forAll(FUNC&& func) {
+        Tagged::forAll([&](uint64_t word) { func(Tagged::key(word)); });
+    }
+
+    template<typename FUNC>
+    void parallelForAll(FUNC&& func) {
+        Tagged::parallelForAll([&](uint64_t word) { func(Tagged::key(word)); });
+    }
+
+    // func(key, mask) for all keys
+    template<typename FUNC>
+    void parallelForAllMasked(FUNC&& func) {
+        Tagged::parallelForAll([&](uint64_t word) { func(Tagged::key(word), Tagged::tag(word)); });
+    }
+};
+
+// per-thread counts of the moves that were skipped, and of those that were canonicalized
+class BackStats {
+    struct alignas(64) Thread { // one per thread, to avoid false sharing
+        uint64_t skipped = 0;
+        uint64_t expanded = 0;
+    };
+
+public:
+    BackStats(): _threads(omp_get_max_threads()) {}
+
+    // the moves of a frontier matrix, of which those in back are skipped
+    __attribute__((always_inline))
+    void count(uint64_t moves, uint64_t back) {
+        Thread& t = _threads[omp_get_thread_num()];
+        t.skipped += __builtin_popcountll(moves & back);
+        t.expanded += __builtin_popcountll(moves & ~back);
+    }
+
+    // skipped and canonicalized moves since the previous call (only when quiescent)
+    std::pair<uint64_t,uint64_t> take() {
+        uint64_t skipped = 0, expanded = 0;
+        for (Thread& t : _threads) {
+            skipped += t.skipped;
+            expanded += t.expanded;
+            t.skipped = t.expanded = 0;
+        }
+        return std::make_pair(skipped, expanded);
+    }
+
+private:
+    std::vector<Thread> _threads;
+};
+
+inline BackStats backStats; // shared by all levels
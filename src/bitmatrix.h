@@ -0,0 +1,108 @@
+/*
+ * Jaco van de Pol, Aarhus University, 2025
+ *
+ * Bit-matrix kernels: permute the rows and columns of an NxN Boolean matrix,
+ * transpose it, and count its rows and columns, in O(N) instead of O(N^2) steps.
+ *
+ * A matrix is stored with stride N (row i in bits N*i .. N*i+N-1). The kernels
+ * work on a stride-8 copy, with one byte per row: permuting the rows is then
+ * a byte shuffle, and permuting the columns applies the same 8x8 bit matrix to
+ * every byte (gf2p8affineqb), or otherwise a row permutation of the transpose.
+ * The fastest kernel is selected at run time, so a binary built for an older
+ * CPU still uses GFNI and BMI2 on the nodes that have them.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <immintrin.h>
+#include "options.h"
+
+namespace bitmatrix {
+
+const uint64_t ROW = (1ULL << N) - 1;                          // the bits of one row
+const uint64_t STRIDE8 = ROW * (0x0101010101010101ULL >> 8*(8-N)); // the bits of an NxN matrix, stride 8
+const uint64_t DIAG8 = 0x8040201008040201ULL & STRIDE8;          // its diagonal, stride 8
+
+// convert a matrix from stride N to stride 8
+inline uint64_t to_stride8(uint64_t x) {
+    if constexpr (N == 8) return x;
+    uint64_t y = 0;
+    for (int i=0; i<N; i++) y |= ((x >> N*i) & ROW) << 8*i;
+    return y;
+}
+
+// convert a matrix from stride 8 to stride N
+inline uint64_t from_stride8(uint64_t x) {
+    if constexpr (N == 8) return x;
+    uint64_t y = 0;
+    for (int i=0; i<N; i++) y |= ((x >> 8*i) & ROW) << N*i;
+    return y;
+}
+
+// transpose an 8x8 matrix (stride 8), by swapping ever larger blocks
+inline uint64_t transpose8(uint64_t x) {
+    uint64_t t;
+    t = (x ^ (x >> 7))  & 0x00AA00AA00AA00AAULL; x ^= t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL; x ^= t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL; x ^= t ^ (t << 28);
+    return x;
+}
+
+// the number of bits in every byte, in that byte
+inline uint64_t byte_counts(uint64_t x) {
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    return (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+}
+
+// y[i] := x[pi[i]] for the rows of a stride-8 matrix
+inline uint64_t shuffle_rows(uint64_t x, const uint8_t pi[]) {
+    uint64_t y = 0;
+    for (int i=0; i<N; i++) y |= ((x >> 8*pi[i]) & 0xFF) << 8*i;
+    return y;
+}
+
+// y[i][j] := x[pi1[i]][pi2[j]], with shifts and masks only
+inline uint64_t permute_portable(uint64_t x, const uint8_t pi1[], const uint8_t pi2[]) {
+    uint64_t y = shuffle_rows(to_stride8(x), pi1);
+    y = transpose8(shuffle_rows(transpose8(y), pi2));
+    return from_stride8(y);
+}
+
+// y[i][j] := x[pi1[i]][pi2[j]], with pdep/pext for the strides, pshufb for
+// the rows, and gf2p8affineqb for the columns
+__attribute__((target("gfni,bmi2,ssse3")))
+inline uint64_t permute_gfni(uint64_t x, const uint8_t pi1[], const uint8_t pi2[]) {
+    uint64_t rows = 0x8080808080808080ULL; // pshufb clears the rows above N
+    uint64_t cols = 0;                     // output bit j of a byte is input bit pi2[j]
+    for (int i=0; i<N; i++) {
+        rows ^= uint64_t(0x80 ^ pi1[i]) << 8*i;
+        cols |= uint64_t(1U << pi2[i]) << 8*(7-i);
+    }
+    __m128i v = _mm_cvtsi64_si128(_pdep_u64(x, STRIDE8));
+    v = _mm_shuffle_epi8(v, _mm_cvtsi64_si128(rows));
+    v = _mm_gf2p8affine_epi64_epi8(v, _mm_cvtsi64_si128(cols), 0);
+    return _pext_u64(_mm_cvtsi128_si64(v), STRIDE8);
+}
+
+enum Kernel { PORTABLE = 0, GFNI = 1 };
+
+#if defined(__GFNI__) && defined(__BMI2__) && defined(__SSSE3__)
+const Kernel kernel = GFNI; // known at compile time
+#else
+inline const Kernel kernel = [] {
+    __builtin_cpu_init(); // this may run before the constructors of libgcc
+    return __builtin_cpu_supports("gfni") && __builtin_cpu_supports("bmi2")
+        && __builtin_cpu_supports("ssse3") ? GFNI : PORTABLE;
+}();
+#endif
+
+inline const char* kernel_name() { return kernel == GFNI ? "gfni" : "portable"; }
+
+// y[i][j] := x[pi1[i]][pi2[j]], with the kernel of this CPU
+inline uint64_t permute(uint64_t x, const uint8_t pi1[], const uint8_t pi2[]) {
+    return kernel == GFNI ? permute_gfni(x, pi1, pi2) : permute_portable(x, pi1, pi2);
+}
+
+} // namespace bitmatrix
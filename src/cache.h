@@ -0,0 +1,82 @@
+/*
+ * Jaco van de Pol, Aarhus University, 2025
+ *
+ * CanonCache: a per-thread, direct-mapped cache of canonical forms.
+ *
+ * Successors of neighbouring frontier matrices overlap, so the same raw matrix
+ * is often canonicalized many times. Every thread owns a table of 2^scale entries,
+ * each holding a raw matrix with its canonical form and number of automorphisms
+ * (its orbit size is only needed for new matrices). A raw matrix is looked up in
+ * one entry only, and a miss overwrites that entry. The empty entry has raw
+ * matrix 0, which is never canonicalized (it is singular).
+ * Hits and misses are counted per thread, and summed when the level is reported.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <omp.h>
+
+class CanonCache {
+public:
+    CanonCache(): _scale(0) {}
+
+    // 2^scale entries per thread (0 disables the cache)
+    void init(size_t scale) {
+        _scale = scale;
+        _threads = std::vector<Thread>(omp_get_max_threads());
+    }
+
+    bool enabled() const { return _scale > 0; }
+
+    // set y to its canonical form and return its number of automorphisms, computed by canon if needed
+    template<typename CANON>
+    __attribute__((always_inline))
+    uint64_t lookup(uint64_t &y, CANON&& canon) {
+        Thread& t = _threads[omp_get_thread_num()];
+        if (!t.table) t.table.reset(new Entry[1ULL << _scale]()); // first use by this thread
+        Entry& e = t.table[(y * 0x9e3779b97f4a7c15ULL) >> (64 - _scale)];
+        if (e.raw == y) {
+            t.hits++;
+            y = e.canon;
+            return e.aut;
+        }
+        t.misses++;
+        e.raw = y;
+        e.aut = canon(y);
+        e.canon = y;
+        return e.aut;
+    }
+
+    // hits and misses since the previous call (only when quiescent)
+    std::pair<uint64_t,uint64_t> take() {
+        uint64_t hits = 0, misses = 0;
+        for (Thread& t : _threads) {
+            hits += t.hits;
+            misses += t.misses;
+            t.hits = t.misses = 0;
+        }
+        return std::make_pair(hits, misses);
+    }
+
+private:
+    struct Entry {
+        uint64_t raw;
+        uint64_t canon;
+        uint64_t aut;
+    };
+
+    struct alignas(64) Thread { // one per thread, to avoid false sharing of the counters
+        std::unique_ptr<Entry[]> table;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    size_t _scale;
+    std::vector<Thread> _threads;
+};
+
+inline CanonCache canonCache; // shared by all levels
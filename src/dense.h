@@ -0,0 +1,236 @@
+/*
+ * Jaco van de Pol, Aarhus University, 2025
+ *
+ * Dense BFS (DENSE=1, N<=6): all of GL(N,2), without symmetry reduction, hashing or
+ * canonicalization, as an independent check of the level sizes of generate_bfs.
+ *
+ * An invertible matrix is ranked row by row: row i is one of the 2^N - 2^i vectors
+ * outside the span of rows 0..i-1, so its digit is the number of such vectors below
+ * it. A span is kept as the set of its elements, a mask of 2^N <= 64 bits, so a digit
+ * is a popcount, and adding a row XOR-translates the mask with one swap of bit blocks
+ * per bit of the row. The mixed-radix number of the digits is a bijection between
+ * GL(N,2) and 0..|GL(N,2)|-1 (about 2*10^10 for N=6). The neighbours of a matrix are
+ * ranked from its digits and spans, recomputing only the rows that a move affects.
+ *
+ * Every matrix has 2 bits in a DistanceArray: 0 if unvisited, otherwise its depth
+ * mod 3, plus 1. The neighbours of a matrix at depth d are at depth d-1, d or d+1
+ * (a move is its own inverse), so this distinguishes the frontier (depth d) from
+ * the next level. A level is expanded top-down (every frontier matrix marks its
+ * unvisited neighbours) while the frontier is small, and bottom-up (every unvisited
+ * matrix looks for a neighbour in the frontier, and stops at the first) once the
+ * frontier holds more than 1/BOTTOM_UP of the unvisited matrices, from the peak level
+ * on. Every matrix has the same number of neighbours, so this compares the edges that
+ * either direction would check, where bottom-up checks all edges only of the matrices
+ * that stay unvisited.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <omp.h>
+#include "arena.h"
+#include "matrix.h"
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+namespace dense {
+
+// the number of choices for row i: the vectors outside the span of i independent rows
+constexpr uint64_t radix(byte i) { return (1ULL << N) - (1ULL << i); }
+
+// the number of invertible N x N matrices, and of their first i rows: prod_{k<i} radix(k)
+struct Prefixes {
+    uint64_t at[N+1];
+    constexpr Prefixes(): at() {
+        at[0] = 1;
+        for (byte i=0; i<N; i++) at[i+1] = at[i] * radix(i);
+    }
+};
+constexpr Prefixes PREFIX;
+const uint64_t STATES = PREFIX.at[N];
+
+// switch to bottom-up once the frontier exceeds the unvisited matrices / BOTTOM_UP
+const uint64_t BOTTOM_UP = 2;
+
+// a subspace of the vectors of N bits, as the set of its elements: bit v is set iff v is in it
+typedef uint64_t span_t;
+
+const uint64_t VECTORS = N == 6 ? ~0ULL : (1ULL << (1 << N)) - 1; // all 2^N vectors
+const uint64_t LOW[6] = { 0x5555555555555555ULL, 0x3333333333333333ULL, 0x0F0F0F0F0F0F0F0FULL,
+                          0x00FF00FF00FF00FFULL, 0x0000FFFF0000FFFFULL, 0x00000000FFFFFFFFULL };
+
+// the span of s and v
+inline span_t extend(span_t s, uint16_t v) {
+    span_t t = s; // t := {u ^ v | u in s}, by swapping the blocks of 2^k for every bit k of v
+    for (byte k=0; k<N; k++) { // without branches, which the random bits of v would mispredict
+        span_t swapped = ((t & LOW[k]) << (1 << k)) | ((t >> (1 << k)) & LOW[k]);
+        span_t bit = -span_t((v >> k) & 1);
+        t = (swapped & bit) | (t & ~bit);
+    }
+    return s | t;
+}
+
+// the number of vectors outside s below v
+inline uint64_t digit(span_t s, uint16_t v) {
+    return v - __builtin_popcountll(s & ((1ULL << v) - 1));
+}
+
+// the vector outside s with d vectors outside s below it
+inline uint16_t select(span_t s, uint64_t d) {
+#if defined(__BMI2__)
+    return __builtin_ctzll(_pdep_u64(1ULL << d, ~s & VECTORS));
+#else
+    uint64_t outside = ~s & VECTORS;
+    for (; d; d--) outside &= outside - 1;
+    return __builtin_ctzll(outside);
+#endif
+}
+
+const matrix ROW = (1ULL << N) - 1;
+
+// the rank of the invertible x in 0..STATES-1
+inline uint64_t rank(matrix x) {
+    span_t s = 1; // {0}
+    uint64_t r = 0;
+    for (byte i=0; i<N; i++) {
+        uint16_t row = (x >> N*i) & ROW;
+        r += digit(s, row) * PREFIX.at[i];
+        s = extend(s, row);
+    }
+    return r;
+}
+
+// An invertible matrix with its rank, and the digits of its rows and the spans before them.
+// The move (i,j) only changes row j, so the rank of its result only needs the digits from
+// row j up to row i (if i > j), since from row i on the span is the same again.
+class Ranked {
+public:
+    // the invertible matrix of rank r
+    explicit Ranked(uint64_t r): _rank(r) { unrank<0>(r, 1); }
+
+    matrix x() const {
+        matrix x = 0;
+        for (byte i=0; i<N; i++) x |= matrix(_row[i]) << N*i;
+        return x;
+    }
+
+    // the rank of successor(x(), i, j)
+    uint64_t successor(byte i, byte j) const {
+        uint16_t row = _row[j] ^ _row[i];
+        uint64_t r = _rank + (digit(_span[j], row) - _digit[j]) * PREFIX.at[j];
+        span_t s = _span[j];
+        for (byte k=j+1; k<=i; k++) {
+            s = extend(s, k == j+1 ? row : _row[k-1]);
+            r += (digit(s, _row[k]) - _digit[k]) * PREFIX.at[k];
+        }
+        assert(r == rank(::successor(x(), i, j)));
+        return r;
+    }
+
+private:
+    // the rows from I on, for the remaining digits r and the span s of the rows before I
+    // (unrolled, so that the divisions are by constants)
+    template<byte I>
+    void unrank(uint64_t r, span_t s) {
+        if constexpr (I < N) {
+            _digit[I] = r % radix(I);
+            _span[I] = s;
+            _row[I] = select(s, _digit[I]);
+            unrank<I+1>(r / radix(I), extend(s, _row[I]));
+        }
+    }
+
+    uint64_t _rank;
+    uint16_t _row[N];
+    uint64_t _digit[N];
+    span_t _span[N]; // the span of rows 0..i-1
+};
+
+} // namespace dense
+
+// 2 bits per invertible matrix: 0 if unvisited, otherwise 1 + (its depth mod 3)
+class DistanceArray {
+public:
+    static constexpr uint64_t WORDS = (dense::STATES + 31) / 32;
+    static constexpr uint64_t ONES = 0x5555555555555555ULL; // the low bit of every entry
+
+    DistanceArray() {
+        _words = (std::atomic<uint64_t>*)arena.map(WORDS * sizeof(uint64_t));
+        if (!_words) {
+            printf("Cannot allocate the distance array (%lu MB)\n", (WORDS * 8) >> 20);
+            exit(-1);
+        }
+    }
+
+    ~DistanceArray() { arena.unmap(_words, WORDS * sizeof(uint64_t)); }
+
+    static uint64_t value(uint64_t depth) { return 1 + depth % 3; }
+
+    void visit(uint64_t r, uint64_t depth) {
+        _words[r / 32].fetch_or(value(depth) << 2*(r % 32), std::memory_order_relaxed);
+    }
+
+    uint64_t get(uint64_t r) const {
+        return (_words[r / 32].load(std::memory_order_relaxed) >> 2*(r % 32)) & 3;
+    }
+
+    // visit the unvisited neighbours of the matrices at depth-1; return their number
+    uint64_t top_down(uint64_t depth) {
+        uint64_t cur = value(depth-1), count = 0;
+        #pragma omp parallel for schedule(dynamic, 1024) reduction(+:count)
+        for (uint64_t w=0; w<WORDS; w++) {
+            for (uint64_t found = matching(w, cur); found; found &= found - 1) {
+                dense::Ranked x(32*w + __builtin_ctzll(found) / 2);
+                for (byte i=0; i<N; i++)
+                    for (byte j=0; j<N; j++) {
+                        if (i == j) continue;
+                        uint64_t r = x.successor(i, j);
+                        std::atomic<uint64_t> &word = _words[r / 32];
+                        uint64_t shift = 2*(r % 32);
+                        uint64_t old = word.load(std::memory_order_relaxed);
+                        while (((old >> shift) & 3) == 0 && !word.compare_exchange_weak(
+                                    old, old | value(depth) << shift, std::memory_order_relaxed)) {}
+                        count += ((old >> shift) & 3) == 0; // only the exchange that succeeded
+                    }
+            }
+        }
+        return count;
+    }
+
+    // visit the unvisited matrices with a neighbour at depth-1; return their number
+    uint64_t bottom_up(uint64_t depth) {
+        uint64_t cur = value(depth-1), count = 0;
+        #pragma omp parallel for schedule(dynamic, 1024) reduction(+:count)
+        for (uint64_t w=0; w<WORDS; w++) {
+            uint64_t visited = 0; // only this thread writes word w
+            for (uint64_t found = matching(w, 0); found; found &= found - 1) {
+                uint64_t r = 32*w + __builtin_ctzll(found) / 2;
+                if (r >= dense::STATES) break;
+                dense::Ranked x(r);
+                bool near = false;
+                for (byte i=0; i<N && !near; i++)
+                    for (byte j=0; j<N && !near; j++)
+                        near = i != j && get(x.successor(i, j)) == cur;
+                if (near) {
+                    visited |= value(depth) << 2*(r % 32);
+                    count++;
+                }
+            }
+            if (visited) _words[w].fetch_or(visited, std::memory_order_relaxed);
+        }
+        return count;
+    }
+
+private:
+    // the low bits of the entries of word w that equal v
+    uint64_t matching(uint64_t w, uint64_t v) const {
+        uint64_t x = _words[w].load(std::memory_order_relaxed) ^ (v * ONES);
+        return ~(x | x >> 1) & ONES;
+    }
+
+    std::atomic<uint64_t>* _words;
+};
@@ -0,0 +1,133 @@
+/*
+ * Jaco van de Pol, Aarhus University, 2025
+ *
+ * BloomFilter: a cache-blocked Bloom filter for the keys of a completed level.
+ * Filtered: a level set that consults its filter before probing the set itself.
+ *
+ * Most successors of a level are not in the previous or current level, so most
+ * lookups in those (large, cache-cold) tables fail. A filter with a few bits per
+ * key answers most of these lookups from a single cache line: the high bits of
+ * the hash select a block of 512 bits, and the low bits select K bits in it.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <omp.h>
+#include "hashset.h"
+
+class BloomFilter {
+public:
+    static constexpr size_t BLOCK = 512; // bits per block, one cache line
+    static constexpr size_t WORDS = BLOCK / 64;
+
+    BloomFilter(): _blockMask(0), _k(0), _blocks(nullptr) {}
+
+    bool ready() const { return _blocks != nullptr; }
+
+    // Build the filter for the keys of set, using about bits per key
+    template<typename SET>
+    void build(SET& set, size_t keys, size_t bits) {
+        size_t blocks = 1;
+        while (blocks * BLOCK < keys * bits) blocks *= 2;
+        _blockMask = blocks - 1;
+        _k = std::max<size_t>(1, std::lround(bits * M_LN2));
+        _blocks.reset(new Block[blocks]);
+        #pragma omp parallel for schedule(static)
+        for (size_t b=0; b<blocks; b++)
+            for (size_t w=0; w<WORDS; w++) _blocks[b].word[w].store(0, std::memory_order_relaxed);
+        set.parallelForAll([&](uint64_t key) {
+            uint64_t h = MurmurHash64(key);
+            Block& b = _blocks[block(h)];
+            for (size_t i=0; i<_k; i++) {
+                size_t bit = probe(h, i);
+                b.word[bit / 64].fetch_or(1ULL << (bit % 64), std::memory_order_relaxed);
+            }
+        });
+    }
+
+    void deinit() {
+        _blocks.reset();
+        _blockMask = _k = 0;
+    }
+
+    // false if key is certainly not in the set
+    __attribute__((always_inline))
+    bool mayContain(uint64_t key) const {
+        uint64_t h = MurmurHash64(key);
+        const Block& b = _blocks[block(h)];
+        for (size_t i=0; i<_k; i++) {
+            size_t bit = probe(h, i);
+            if (!(b.word[bit / 64].load(std::memory_order_relaxed) & (1ULL << (bit % 64))))
+                return false;
+        }
+        return true;
+    }
+
+    __attribute__((always_inline))
+    void prefetch(uint64_t key) const {
+        __builtin_prefetch(&_blocks[block(MurmurHash64(key))]);
+    }
+
+    size_t bytes() const { return _blocks ? (_blockMask + 1) * BLOCK / 8 : 0; }
+
+private:
+    struct alignas(64) Block {
+        std::atomic<uint64_t> word[WORDS];
+    };
+
+    // the hash table uses the low bits of the hash, so blocks use the high bits
+    size_t block(uint64_t h) const { return (h >> 32) & _blockMask; }
+
+    // the i-th bit in the block: 9 bits from the double hash h1 + i*h2
+    static size_t probe(uint64_t h, size_t i) {
+        uint32_t h1 = h, h2 = (h >> 32) | 1;
+        return ((h1 + i * h2) >> 23) % BLOCK;
+    }
+
+    size_t _blockMask;
+    size_t _k;
+    std::unique_ptr<Block[]> _blocks;
+};
+
+// A level set with a Bloom filter, built by filter() when the level is complete
+template<typename SET>
+class Filtered : public SET {
+public:
+    using TO_TYPE = typename SET::TO_TYPE;
+
+    // build the filter for the given number of keys, with about bits per key (only when quiescent)
+    void filter(size_t keys, size_t bits) {
+        _filter.build(static_cast<SET&>(*this), keys, bits);
+    }
+
+    void deinit() {
+        _filter.deinit();
+        SET::deinit();
+    }
+
+    __attribute__((always_inline))
+    TO_TYPE contains(uint64_t key) {
+        if (_filter.ready() && !_filter.mayContain(key)) return 0;
+        return SET::contains(key);
+    }
+
+    // once there is a filter, the set itself is rarely probed
+    __attribute__((always_inline))
+    void prefetch(uint64_t key) const {
+        if (_filter.ready()) _filter.prefetch(key);
+        else SET::prefetch(key);
+    }
+
+    void stats() {
+        SET::stats();
+        if (_filter.ready())
+            printf("...filter: %ld bytes\n", _filter.bytes());
+    }
+
+private:
+    BloomFilter _filter;
+};
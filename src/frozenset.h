@@ -0,0 +1,331 @@
+/*
+ * Jaco van de Pol, Aarhus University, 2025
+ *
+ * FrozenSet: a static, succinct set of 64-bit keys, using the Elias-Fano encoding.
+ * FreezingSet: a concurrent hash set that can be frozen into a FrozenSet.
+ *
+ * A completed BFS level is only used for membership queries and iteration.
+ * Freezing it sorts the keys, and stores for each key its l low bits explicitly,
+ * and its high bits in unary, in a bit vector with one 1 per key and one 0 per
+ * high value. This takes about l+2 bits per key, where l = log2(max/size).
+ * Every SAMPLE-th 0 is indexed, to jump to the keys with a given high value.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <parallel/algorithm>
+#include <omp.h>
+
+class FrozenSet {
+public:
+    static constexpr uint64_t SAMPLE = 256; // index every SAMPLE-th 0 in the high bits
+
+    FrozenSet(): _size(0), _max(0), _lowBits(0), _highLength(0) {}
+
+    // Build from a set that supports parallelForAll (not modified concurrently)
+    template<typename SET>
+    void build(SET& set) {
+        // collect the keys per thread, then concatenate them
+        int threads = omp_get_max_threads();
+        std::vector<std::vector<uint64_t>> local(threads);
+        set.parallelForAll([&](uint64_t key) {
+            local[omp_get_thread_num()].push_back(key);
+        });
+        build(local);
+    }
+
+    // Build from per-thread vectors of unique keys (which are emptied)
+    void build(std::vector<std::vector<uint64_t>>& local) {
+        int threads = local.size();
+        std::vector<uint64_t> offset(threads + 1, 0);
+        for (int t=0; t<threads; t++)
+            offset[t+1] = offset[t] + local[t].size();
+        std::vector<uint64_t> keys(offset[threads]);
+        #pragma omp parallel for
+        for (int t=0; t<threads; t++) {
+            std::copy(local[t].begin(), local[t].end(), keys.begin() + offset[t]);
+            std::vector<uint64_t>().swap(local[t]);
+        }
+        build(keys);
+    }
+
+    // Build from a vector of unique keys (the vector is sorted in place)
+    void build(std::vector<uint64_t>& keys) {
+        __gnu_parallel::sort(keys.begin(), keys.end());
+        _size = keys.size();
+        _max = _size ? keys.back() : 0;
+        _lowBits = 0;
+        while (_size && (_max >> _lowBits) / _size > 1)
+            _lowBits++;
+        uint64_t highs = (_max >> _lowBits) + 1;
+        _highLength = _size + highs;
+
+        _low.assign((_size * _lowBits + 63) / 64 + 1, 0);
+        _high.assign(_highLength / 64 + 1, 0);
+        _zeros.assign(highs / SAMPLE + 1, 0);
+
+        // chunks of 64 keys cover whole words of low bits
+        #pragma omp parallel for schedule(static)
+        for (uint64_t c=0; c<_size; c+=64) {
+            for (uint64_t i=c; i<std::min(c+64, _size); i++) {
+                setLow(i, keys[i] & lowMask());
+                uint64_t pos = (keys[i] >> _lowBits) + i;
+                __atomic_fetch_or(&_high[pos / 64], 1ULL << (pos % 64), __ATOMIC_RELAXED);
+            }
+        }
+
+        // the k-th 0 (for high value k) follows all keys with high value <= k
+        #pragma omp parallel for schedule(static)
+        for (uint64_t s=0; s<_zeros.size(); s++) {
+            uint64_t h = s * SAMPLE;
+            uint64_t upper = h >= (_max >> _lowBits) ? _size :
+                std::lower_bound(keys.begin(), keys.end(), (h + 1) << _lowBits) - keys.begin();
+            _zeros[s] = h + upper;
+        }
+    }
+
+    void deinit() {
+        _size = _max = _lowBits = _highLength = 0;
+        std::vector<uint64_t>().swap(_low);
+        std::vector<uint64_t>().swap(_high);
+        std::vector<uint64_t>().swap(_zeros);
+    }
+
+    size_t size() const { return _size; }
+
+    size_t bytes() const {
+        return (_low.size() + _high.size() + _zeros.size()) * sizeof(uint64_t);
+    }
+
+    bool contains(uint64_t key) const {
+        if (key > _max || _size == 0) return false;
+        uint64_t h = key >> _lowBits;
+        uint64_t low = key & lowMask();
+        uint64_t pos = h ? select0(h-1) + 1 : 0;
+        for (uint64_t i = pos - h; bit(pos); pos++, i++) { // keys in bucket h are sorted
+            uint64_t l = getLow(i);
+            if (l >= low) return l == low;
+        }
+        return false;
+    }
+
+    // A Cursor enumerates the keys in increasing order, starting from some position
+    struct Cursor {
+        const FrozenSet* set;
+        uint64_t pos;   // position in the high bits
+        uint64_t index; // index of the key
+        uint64_t h;     // high value at pos
+
+        bool valid() const { return index < set->_size; }
+
+        uint64_t key() const { return (h << set->_lowBits) | set->getLow(index); }
+
+        void skipZeros() {
+            while (pos < set->_highLength && !set->bit(pos)) { pos++; h++; }
+        }
+
+        void next() { pos++; index++; skipZeros(); }
+    };
+
+    // cursor at the first key with high value >= h
+    Cursor cursor(uint64_t h) const {
+        Cursor c { this, 0, 0, 0 };
+        if (h > (_max >> _lowBits)) { c.index = _size; return c; }
+        c.pos = h ? select0(h-1) + 1 : 0;
+        c.index = c.pos - h;
+        c.h = h;
+        c.skipZeros();
+        return c;
+    }
+
+    // cursor at the first key >= key
+    Cursor seek(uint64_t key) const {
+        Cursor c = cursor(key >> _lowBits);
+        while (c.valid() && c.key() < key) c.next();
+        return c;
+    }
+
+    template<typename FUNC>
+    void forAll(FUNC&& func) const {
+        for (Cursor c = cursor(0); c.valid(); c.next())
+            func(c.key());
+    }
+
+    // Every task handles the keys with high values between two sampled 0s
+    template<typename FUNC>
+    void parallelForAll(FUNC&& func) const {
+        #pragma omp parallel for schedule(dynamic, 16)
+        for (uint64_t s=0; s<_zeros.size(); s++) {
+            uint64_t end = std::min((s+1) * SAMPLE, (_max >> _lowBits) + 1);
+            for (Cursor c = cursor(s * SAMPLE); c.valid() && c.h < end; c.next())
+                func(c.key());
+        }
+    }
+
+    // Some key in both sets (or 0), by a parallel sorted merge
+    friend uint64_t intersect(const FrozenSet& L1, const FrozenSet& L2) {
+        std::atomic<uint64_t> joint(0);
+        #pragma omp parallel for schedule(dynamic, 16)
+        for (uint64_t s=0; s<L1._zeros.size(); s++) {
+            if (joint.load(std::memory_order_relaxed)) continue; // found already
+            uint64_t end = std::min((s+1) * SAMPLE, (L1._max >> L1._lowBits) + 1);
+            FrozenSet::Cursor c1 = L1.cursor(s * SAMPLE);
+            if (!c1.valid() || c1.h >= end) continue;
+            FrozenSet::Cursor c2 = L2.seek(c1.key());
+            while (c1.valid() && c1.h < end && c2.valid()) {
+                uint64_t k1 = c1.key(), k2 = c2.key();
+                if (k1 == k2) { joint = k1; break; }
+                if (k1 < k2) c1.next(); else c2.next();
+            }
+        }
+        return joint;
+    }
+
+private:
+    uint64_t lowMask() const { return (1ULL << _lowBits) - 1; }
+
+    bool bit(uint64_t pos) const {
+        return pos < _highLength && (_high[pos / 64] >> (pos % 64)) & 1;
+    }
+
+    uint64_t getLow(uint64_t i) const {
+        if (_lowBits == 0) return 0;
+        uint64_t b = i * _lowBits;
+        uint64_t w = b / 64, o = b % 64;
+        uint64_t v = _low[w] >> o;
+        if (o + _lowBits > 64) v |= _low[w+1] << (64 - o);
+        return v & lowMask();
+    }
+
+    void setLow(uint64_t i, uint64_t v) {
+        if (_lowBits == 0) return;
+        uint64_t b = i * _lowBits;
+        uint64_t w = b / 64, o = b % 64;
+        _low[w] |= v << o;
+        if (o + _lowBits > 64) _low[w+1] |= v >> (64 - o);
+    }
+
+    // position of the k-th 0 in the high bits (starting from 0)
+    uint64_t select0(uint64_t k) const {
+        uint64_t s = k / SAMPLE;
+        uint64_t pos = _zeros[s];
+        uint64_t left = k - s * SAMPLE; // zeros still to skip after pos
+        if (left == 0) return pos;
+        pos++;
+        uint64_t w = pos / 64;
+        uint64_t zeros = ~_high[w] & (~0ULL << (pos % 64));
+        while (true) {
+            uint64_t cnt = __builtin_popcountll(zeros);
+            if (cnt >= left) break;
+            left -= cnt;
+            zeros = ~_high[++w];
+        }
+        for (; left > 1; left--) zeros &= zeros - 1; // drop lowest zeros
+        return w * 64 + __builtin_ctzll(zeros);
+    }
+
+    uint64_t _size;
+    uint64_t _max;
+    uint64_t _lowBits;
+    uint64_t _highLength;
+    std::vector<uint64_t> _low;
+    std::vector<uint64_t> _high;
+    std::vector<uint64_t> _zeros;
+};
+
+// A concurrent hash set for a level under construction, that is frozen when it is complete
+template<typename SET>
+class FreezingSet {
+public:
+    using TO_TYPE = typename SET::TO_TYPE;
+
+    FreezingSet(): _isFrozen(false) {}
+
+    template<typename... ARGS>
+    FreezingSet& init(ARGS... args) {
+        _live.init(args...);
+        _isFrozen = false;
+        return *this;
+    }
+
+    void deinit() {
+        _live.deinit();
+        _frozen.deinit();
+    }
+
+    FreezingSet& operator=(const FreezingSet& other) = delete;
+
+    FreezingSet& operator=(FreezingSet&& other) {
+        _live = std::move(other._live);
+        _frozen = std::move(other._frozen);
+        _isFrozen = other._isFrozen;
+        return *this;
+    }
+
+    void reclaim() { _live.reclaim(); }
+
+    // convert to the succinct representation, after which no inserts are allowed
+    void freeze() {
+        assert(!_isFrozen && "already frozen");
+        _frozen.build(_live);
+        _live.deinit();
+        _isFrozen = true;
+    }
+
+    // freeze from per-thread vectors of unique keys, instead of the live set
+    void freeze(std::vector<std::vector<uint64_t>>& local) {
+        assert(!_isFrozen && "already frozen");
+        _frozen.build(local);
+        _live.deinit();
+        _isFrozen = true;
+    }
+
+    bool frozen() const { return _isFrozen; }
+
+    const FrozenSet& frozenSet() const { return _frozen; }
+
+    __attribute__((always_inline))
+    bool insert(uint64_t key) {
+        assert(!_isFrozen && "insert in frozen set");
+        return _live.insert(key);
+    }
+
+    // only the live set is prefetched: the frozen set is much smaller
+    __attribute__((always_inline))
+    void prefetch(uint64_t key) const {
+        if (!_isFrozen) _live.prefetch(key);
+    }
+
+    __attribute__((always_inline))
+    TO_TYPE contains(uint64_t key) {
+        if (_isFrozen) return _frozen.contains(key);
+        return _live.contains(key);
+    }
+
+    void stats() {
+        if (_isFrozen)
+            printf("...frozen set: Size: %ld, %.2f bits per key\n", _frozen.size(),
+                   _frozen.size() ? 8.0 * _frozen.bytes() / _frozen.size() : 0.0);
+        else
+            _live.stats();
+    }
+
+    template<typename FUNC>
+    void forAll(FUNC&& func) {
+        if (_isFrozen) _frozen.forAll(func);
+        else _live.forAll(func);
+    }
+
+    template<typename FUNC>
+    void parallelForAll(FUNC&& func) {
+        if (_isFrozen) _frozen.parallelForAll(func);
+        else _live.parallelForAll(func);
+    }
+
+private:
+    SET _live;
+    FrozenSet _frozen;
+    bool _isFrozen;
+};
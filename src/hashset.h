@@ -27,10 +27,18 @@
 #include <atomic>
 #include <algorithm>
 #include <cstdio>
-#include <sys/mman.h>
 #include <thread>
 #include <assert.h>
 #include <map>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <omp.h>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include "arena.h"
 
 
 template<typename TO_TYPE, typename TREE>
@@ -112,29 +120,34 @@ struct HashCompare {
     }
 };
 
-template< typename TO_TYPE
+template< typename TO_TYPE_
         , template<typename,typename> typename BUCKETFINDER = Linear
         , template<typename> typename HASH = HashCompare
         >
 class HashSet {
 public:
+    using TO_TYPE = TO_TYPE_;
     using Bucketfinder = BUCKETFINDER<TO_TYPE, HashSet<TO_TYPE, BUCKETFINDER, HASH>>;
     friend Bucketfinder;
 public:
 
-    HashSet(): _scale(0), _buckets(0), _entriesMask(0), _map(nullptr) {
+    HashSet(): _scale(0), _buckets(0), _entriesMask(0), _map(nullptr), _ordered(false), _node(Arena::ANY) {
         assert (HASH<uint64_t>().hash(0) == 0 && "0 should be hashed to 0");
     }
 
+    // the NUMA node for the memory of the next init (Arena::ANY for no preference)
+    void place(int node) { _node = node; }
+
     HashSet& init(size_t scale=28ULL) {
         assert(scale>2 && "scale should be at least 3");
         assert(scale <= sizeof(TO_TYPE)*8 && "scale to large for entry type");
         _scale = scale;
         _buckets = 1ULL << _scale;
         _entriesMask = (_buckets - 1);
+        _ordered = false;
         
         assert(!_map && "map already in use");
-        _map = (decltype(_map))mmap(nullptr, _buckets * sizeof(uint64_t), PROT_READ|PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        _map = (decltype(_map))arena.map(_buckets * sizeof(uint64_t), _node);
         assert(_map && "failed to mmap data");
         //printf("......allocated table %ld: %ld bytes\n", _scale, _buckets * sizeof(uint64_t));
         return *this;
@@ -142,7 +155,7 @@ public:
 
     void deinit() {
         if(_map) {
-            munmap(_map, _buckets * sizeof(uint64_t));
+            arena.unmap(_map, _buckets * sizeof(uint64_t), _node);
             //printf("......deallocated table %ld: %ld bytes\n", _scale, _buckets * sizeof(uint64_t));
             _map = nullptr;
         }
@@ -159,6 +172,8 @@ public:
         _buckets = other._buckets;
         _entriesMask = other._entriesMask;
         _map = other._map;
+        _ordered = other._ordered;
+        _node = other._node;
         other._map = nullptr;
         return *this;
     }
@@ -168,18 +183,41 @@ public:
         return h & _entriesMask;
     }
 
+    // bring the first bucket of the probe sequence of key into the cache
+    __attribute__((always_inline))
+    void prefetch(uint64_t key) const {
+        TO_TYPE e = HASH<uint64_t>().hash(key) & _entriesMask;
+        __builtin_prefetch(&_map[e], 1);
+    }
+
     __attribute__((always_inline))
     constexpr uint64_t newlyInserted(uint64_t v) const {
         return v | 0x8000000000000000ULL;
     }
 
+    // Marks a bucket whose content has been migrated to a larger table.
+    // ~0 is never a key: it has bits outside N*N, or it is the singular all-ones matrix
+    static constexpr uint64_t MOVED = ~0ULL;
+
+    // insertOrContains returns _buckets if it ran into a migrated bucket
+    __attribute__((always_inline))
+    bool moved(TO_TYPE e) const {
+        return e == _buckets;
+    }
+
+    size_t capacity() const {
+        return _buckets;
+    }
+
     template<int INSERT>
     TO_TYPE insertOrContains(uint64_t key, bool &is_new) {
         assert(_map && "storage not initialized");
         assert(key && "cannot store 0");
         assert(_buckets == 1ULL << _scale);
+        assert(!(INSERT && _ordered) && "insert in ordered table");
         TO_TYPE e = entry(key);
         e += e == 0;
+        const TO_TYPE h = e;
         Bucketfinder searcher(*this, e);
         std::atomic<uint64_t>* current = &_map[e];
 
@@ -204,6 +242,13 @@ public:
                 is_new = false;
                 return e;
             }
+            if(k == MOVED) {
+                is_new = false;
+                return _buckets;
+            }
+            // in an ordered table, key would precede k if k has a later home
+            if (!INSERT && _ordered && distance(home(k), e) < distance(h, e))
+                return 0;
             findnext:
             searcher.next();
             current = &_map[e];
@@ -249,12 +294,16 @@ public:
         printf("Size: %ld\n",count.load());
     }
 
+    // Also shows the length of clusters, and of successful and unsuccessful
+    // probe sequences, starting in each bucket (if verbose)
     void statistics(bool verbose=false) {
-        printf("...table 2^%ld: ",_scale);
+        printf("...table 2^%ld%s: ",_scale, _ordered ? " (ordered)" : "");
         size_t count=0;
         size_t run=0;
         bool last=false;
         std::map<uint64_t,uint64_t> frequency;
+        std::map<uint64_t,uint64_t> hits;
+        std::map<uint64_t,uint64_t> misses;
 
         for (uint64_t i=0; i<_buckets; i++) {
             // printf("%d",get(i)>0);
@@ -262,6 +311,7 @@ public:
                 count++;
                 run++;
                 last=true;
+                if (verbose) hits[1 + distance(home(_map[i]), i)]++;
             }
             else {
                 if (last && verbose) {
@@ -270,10 +320,59 @@ public:
                     run=0;
                 }
             }
+            if (verbose && i > 0) misses[missLength(i)]++;
         }
         printf("Size: %ld\n",count);
         for (auto f : frequency) {
-            if (verbose) printf("      probes of length %ld : %ldx\n",f.first,f.second);
+            if (verbose) printf("      clusters of length %ld : %ldx\n",f.first,f.second);
+        }
+        for (auto f : hits)
+            printf("      successful probes of length %ld : %ldx\n",f.first,f.second);
+        for (auto f : misses)
+            printf("      unsuccessful probes of length %ld : %ldx\n",f.first,f.second);
+    }
+
+    // Sort every cluster of keys by home bucket (only when no thread accesses the set).
+    // Afterwards, a key precedes all keys with a later home, as in Robin Hood hashing,
+    // so an unsuccessful lookup stops at the first key that is closer to its home.
+    // No keys can be inserted into an ordered table.
+    void order() {
+        static_assert(std::is_same<Bucketfinder, Linear<TO_TYPE, HashSet>>::value,
+                      "ordering requires linear probing");
+        const size_t CHUNK = 1ULL << 16;
+        #pragma omp parallel
+        {
+            std::vector<std::pair<TO_TYPE, uint64_t>> cluster;
+            // every cluster is sorted by the thread that owns the chunk in which it starts
+            #pragma omp for schedule(dynamic, 1)
+            for (size_t lo=1; lo<_buckets; lo+=CHUNK) {
+                for (size_t p=lo; p<std::min(lo+CHUNK, _buckets); p++) {
+                    if (!_map[p] || _map[before(p)]) continue;
+                    cluster.clear();
+                    for (TO_TYPE q=p; _map[q] && cluster.size() < _buckets; q=after(q)) {
+                        uint64_t k = _map[q].load(std::memory_order_relaxed);
+                        cluster.emplace_back(distance(p, home(k)), k);
+                    }
+                    std::sort(cluster.begin(), cluster.end());
+                    TO_TYPE q = p;
+                    for (auto& c : cluster) {
+                        _map[q].store(c.second, std::memory_order_relaxed);
+                        q = after(q);
+                    }
+                }
+            }
+        }
+        _ordered = true;
+    }
+
+    bool ordered() const { return _ordered; }
+
+    // Move the keys in buckets [lo,hi) to the (larger) table to, leaving MOVED behind.
+    // Concurrent inserts into these buckets either happen before the exchange, or see MOVED.
+    void migrate(size_t lo, size_t hi, HashSet& to) {
+        for (size_t i=lo; i<hi; i++) {
+            uint64_t k = _map[i].exchange(MOVED, std::memory_order_acq_rel);
+            if (k) to.insert(k);
         }
     }
 
@@ -298,9 +397,806 @@ public:
         }
     }
 
+private:
+    // first bucket of the probe sequence of key (bucket 0 is never used)
+    TO_TYPE home(uint64_t key) const {
+        TO_TYPE e = HASH<uint64_t>().hash(key) & _entriesMask;
+        return e + (e == 0);
+    }
+
+    // number of linear probes from bucket h to bucket p, skipping bucket 0
+    TO_TYPE distance(TO_TYPE h, TO_TYPE p) const {
+        return ((p - h) & _entriesMask) - (p < h);
+    }
+
+    TO_TYPE before(TO_TYPE p) const { return p > 1 ? p - 1 : _buckets - 1; }
+
+    TO_TYPE after(TO_TYPE p) const { return p + 1 < _buckets ? p + 1 : 1; }
+
+    // probes of an unsuccessful lookup of a key with home h
+    size_t missLength(TO_TYPE h) const {
+        size_t probes = 1;
+        for (TO_TYPE p=h; _map[p] && probes < _buckets; p=after(p), probes++)
+            if (_ordered && distance(home(_map[p]), p) < distance(h, p)) break;
+        return probes;
+    }
+
 public:
     size_t _scale;
     size_t _buckets;
     size_t _entriesMask;
     std::atomic<uint64_t>* _map;
+    bool _ordered; // clusters are sorted by home bucket, see order()
+    int _node;     // NUMA node of the memory, see place()
+};
+
+/*
+ * CompactHashSet: a Cleary-style compact hash set for keys of KEYBITS bits.
+ * Jaco van de Pol, Aarhus University, 2025
+ *
+ * Keys are scrambled by an invertible hash on KEYBITS bits. The low bits of the
+ * hash (the quotient) select the home word of 64 bits, which is divided into a
+ * few slots. A slot only stores the remainder of the hash, together with the
+ * displacement of its word from the home word (+1, so an empty slot is 0).
+ * Words are probed linearly and filled from slot 0 upwards. A slot is claimed
+ * with a CAS on its whole word, so concurrent insertion remains lock-free.
+ * The slot width, and hence the number of slots per word, depends on the scale.
+ */
+
+template<size_t KEYBITS>
+class CompactHashSet {
+public:
+    using TO_TYPE = uint64_t;
+    static constexpr uint64_t KEYMASK = KEYBITS >= 64 ? ~0ULL : (1ULL << KEYBITS) - 1;
+    // A word of all 1s is never used: that would need the unused maximal displacement
+    static constexpr uint64_t MOVED = ~0ULL;
+    static constexpr uint64_t MOVED_INDEX = ~0ULL;
+
+    CompactHashSet(): _scale(0), _buckets(0), _entriesMask(0), _map(nullptr), _node(Arena::ANY) {}
+
+    // the NUMA node for the memory of the next init (Arena::ANY for no preference)
+    void place(int node) { _node = node; }
+
+    // allocate (at least) 2^scale slots
+    CompactHashSet& init(size_t scale=28ULL) {
+        assert(scale>2 && "scale should be at least 3");
+        _scale = std::min(scale, KEYBITS); // 2^KEYBITS slots can hold all keys
+        // pick the largest number of slots per word such that the slots fit
+        for (_slots = 8; _slots > 1; _slots--) {
+            size_t wordScale = _scale - std::min<size_t>(_scale, 63 - __builtin_clzll(_slots));
+            if (_slots * (KEYBITS - wordScale + DISP) <= 64) break;
+        }
+        _dispBits = _slots == 1 ? std::min<size_t>(DISP1, 64 - (KEYBITS - _scale)) : DISP;
+        _wordScale = _scale - std::min<size_t>(_scale, 63 - __builtin_clzll(_slots));
+        _slotBits = KEYBITS - _wordScale + _dispBits;
+        _slotMask = _slotBits >= 64 ? ~0ULL : (1ULL << _slotBits) - 1;
+        _maxDisp = (1ULL << _dispBits) - 3;
+        _buckets = 1ULL << _wordScale;
+        _entriesMask = _buckets - 1;
+        assert(!_map && "map already in use");
+        _map = (decltype(_map))arena.map(_buckets * sizeof(uint64_t), _node);
+        assert(_map && "failed to mmap data");
+        return *this;
+    }
+
+    void deinit() {
+        if(_map) {
+            arena.unmap(_map, _buckets * sizeof(uint64_t), _node);
+            _map = nullptr;
+        }
+    }
+
+    ~CompactHashSet() { deinit(); }
+
+    CompactHashSet& operator=(const CompactHashSet& other) = delete;
+
+    CompactHashSet& operator=(CompactHashSet&& other) {
+        deinit();
+        _scale = other._scale;
+        _buckets = other._buckets;
+        _entriesMask = other._entriesMask;
+        _wordScale = other._wordScale;
+        _slots = other._slots;
+        _dispBits = other._dispBits;
+        _slotBits = other._slotBits;
+        _slotMask = other._slotMask;
+        _maxDisp = other._maxDisp;
+        _map = other._map;
+        _node = other._node;
+        other._map = nullptr;
+        return *this;
+    }
+
+    // invertible hash on KEYBITS bits: multiply by odd constants and xor-shift
+    static constexpr uint64_t hash(uint64_t x) {
+        x = (x * M1) & KEYMASK;
+        x ^= x >> SHIFT;
+        x = (x * M2) & KEYMASK;
+        x ^= x >> SHIFT;
+        return x;
+    }
+
+    static constexpr uint64_t unhash(uint64_t h) {
+        h = unshift(h);
+        h = (h * inverse(M2)) & KEYMASK;
+        h = unshift(h);
+        h = (h * inverse(M1)) & KEYMASK;
+        return h;
+    }
+
+    __attribute__((always_inline))
+    void prefetch(uint64_t key) const {
+        __builtin_prefetch(&_map[hash(key) & _entriesMask], 1);
+    }
+
+    __attribute__((always_inline))
+    bool moved(TO_TYPE e) const {
+        return e == MOVED_INDEX;
+    }
+
+    size_t capacity() const {
+        return _buckets * _slots;
+    }
+
+    // returns 0 if not found, otherwise 1 + the index of the slot
+    template<int INSERT>
+    TO_TYPE insertOrContains(uint64_t key, bool &is_new) {
+        assert(_map && "storage not initialized");
+        assert(key && "cannot store 0");
+        assert(key <= KEYMASK && "key too large");
+        uint64_t h = hash(key);
+        uint64_t home = h & _entriesMask;
+        uint64_t rem = h >> _wordScale;
+
+        for (uint64_t d = 0; d <= _maxDisp && d < _buckets; d++) {
+            uint64_t w = (home + d) & _entriesMask;
+            uint64_t slot = (rem << _dispBits) | (d + 1);
+            uint64_t v = _map[w].load(std::memory_order_relaxed);
+            while (true) {
+                if (v == MOVED) {
+                    is_new = false;
+                    return MOVED_INDEX;
+                }
+                size_t i = 0;
+                for (; i < _slots; i++) {
+                    uint64_t s = (v >> (i * _slotBits)) & _slotMask;
+                    if (s == slot) {
+                        is_new = false;
+                        return 1 + w * _slots + i;
+                    }
+                    if (s == 0) break; // slots are filled in order
+                }
+                if (i == _slots) break; // word is full: probe the next one
+                if (!INSERT) return 0;
+                if (_map[w].compare_exchange_weak(v, v | (slot << (i * _slotBits)), std::memory_order_release, std::memory_order_relaxed)) {
+                    is_new = true;
+                    return 1 + w * _slots + i;
+                }
+                // v has been reloaded: rescan this word
+            }
+        }
+        printf("Hash map full! (2^%ld slots, displacement > %ld)\n", _scale, _maxDisp);
+        exit(-1);
+    }
+
+    __attribute__((always_inline))
+    bool insert(uint64_t key) {
+        bool is_new;
+        insertOrContains<1>(key, is_new);
+        return is_new;
+    }
+
+    __attribute__((always_inline))
+    TO_TYPE contains(uint64_t key) {
+        bool dummy;
+        return insertOrContains<0>(key, dummy);
+    }
+
+    // Move the keys in words [lo,hi) to the (larger) table to, leaving MOVED behind.
+    void migrate(size_t lo, size_t hi, CompactHashSet& to) {
+        for (size_t w=lo; w<hi; w++) {
+            uint64_t v = _map[w].exchange(MOVED, std::memory_order_acq_rel);
+            forWord(w, v, [&](uint64_t key) { to.insert(key); });
+        }
+    }
+
+    void stats() {
+        printf("...table 2^%ld (%ld x %ld bits): ", _scale, _slots, _slotBits);
+        std::atomic<size_t> count(0);
+        #pragma omp parallel for
+        for (uint64_t w=0; w<_buckets; w++)
+            forWord(w, _map[w].load(std::memory_order_relaxed), [&](uint64_t) { count++; });
+        printf("Size: %ld\n",count.load());
+    }
+
+    void statistics(bool verbose=false) {
+        printf("...table 2^%ld (%ld x %ld bits): ", _scale, _slots, _slotBits);
+        size_t count=0;
+        std::map<uint64_t,uint64_t> frequency;
+        for (uint64_t w=0; w<_buckets; w++) {
+            uint64_t v = _map[w].load(std::memory_order_relaxed);
+            for (size_t i = 0; i < _slots; i++) {
+                uint64_t s = (v >> (i * _slotBits)) & _slotMask;
+                if (s == 0) break;
+                count++;
+                if (verbose) frequency[(s & ((1ULL << _dispBits) - 1)) - 1]++;
+            }
+        }
+        printf("Size: %ld\n",count);
+        for (auto f : frequency)
+            printf("      displacement %ld : %ldx\n",f.first,f.second);
+    }
+
+    template<typename FUNC>
+    void forAll(FUNC&& func) {
+        for (uint64_t w=0; w<_buckets; w++)
+            forWord(w, _map[w].load(std::memory_order_relaxed), func);
+    }
+
+    template<typename FUNC>
+    void parallelForAll(FUNC&& func) {
+        #pragma omp parallel for
+        for (uint64_t w=0; w<_buckets; w++)
+            forWord(w, _map[w].load(std::memory_order_relaxed), func);
+    }
+
+private:
+    static constexpr uint64_t M1 = 0x9e3779b97f4a7c15ULL;
+    static constexpr uint64_t M2 = 0xbf58476d1ce4e5b9ULL;
+    static constexpr size_t SHIFT = (KEYBITS + 1) / 2;
+    static constexpr size_t DISP = 5;   // bits for the displacement (in words) if there are more slots per word
+    static constexpr size_t DISP1 = 8;  // bits for the displacement if there is only one slot per word
+
+    // inverse of an odd number modulo 2^64 (Newton iteration)
+    static constexpr uint64_t inverse(uint64_t m) {
+        uint64_t inv = m;
+        for (int i=0; i<5; i++) inv *= 2 - m * inv;
+        return inv;
+    }
+
+    // inverse of x ^= x >> SHIFT
+    static constexpr uint64_t unshift(uint64_t h) {
+        uint64_t x = h;
+        for (size_t s = SHIFT; s < KEYBITS; s += SHIFT)
+            x ^= h >> s;
+        return x;
+    }
+
+    // reconstruct the keys in word w (with contents v) from their slots
+    template<typename FUNC>
+    __attribute__((always_inline))
+    void forWord(uint64_t w, uint64_t v, FUNC&& func) const {
+        if (v == MOVED) return;
+        for (size_t i = 0; i < _slots; i++) {
+            uint64_t s = (v >> (i * _slotBits)) & _slotMask;
+            if (s == 0) break;
+            uint64_t d = (s & ((1ULL << _dispBits) - 1)) - 1;
+            uint64_t home = (w - d) & _entriesMask;
+            func(unhash(((s >> _dispBits) << _wordScale) | home));
+        }
+    }
+
+public:
+    size_t _scale;       // 2-log of the number of slots
+    size_t _buckets;     // number of words
+    size_t _entriesMask;
+    size_t _wordScale;   // 2-log of the number of words (the quotient)
+    size_t _slots;       // slots per word
+    size_t _dispBits;
+    size_t _slotBits;
+    uint64_t _slotMask;
+    uint64_t _maxDisp;
+    std::atomic<uint64_t>* _map;
+    int _node;           // NUMA node of the memory, see place()
+};
+
+/*
+ * SwissHashSet: a hash set with 7-bit tags in a separate array of control bytes.
+ * Jaco van de Pol, Aarhus University, 2025
+ *
+ * The slots are divided into groups of GROUP control bytes, which are compared
+ * to the tag of a key at once, with SSE2 (16 bytes) or AVX2 (32 bytes). A key
+ * is only read from the slots whose tag matches, and a probe ends at the first
+ * group with an empty slot, so most negative lookups read a single group of
+ * control bytes. Groups are probed linearly.
+ *
+ * A control byte is EMPTY (0, so tables from the arena start empty), BUSY, MOVED,
+ * or a tag (with the high bit set). A slot is claimed by a CAS from EMPTY to
+ * BUSY, after which the key is written and the tag is published. Threads that
+ * see a BUSY slot in their group wait until it is published, since it may hold
+ * their own key. Slots are never emptied, so insertion remains lock-free except
+ * for this short window.
+ */
+
+class SwissHashSet {
+public:
+    using TO_TYPE = uint64_t;
+
+#if defined(__AVX2__)
+    static constexpr size_t GROUP = 32;
+    using Mask = uint32_t;
+#else
+    static constexpr size_t GROUP = 16;
+    using Mask = uint32_t;
+#endif
+
+    static constexpr uint8_t EMPTY = 0x00;
+    static constexpr uint8_t BUSY = 0x01;
+    static constexpr uint8_t MOVED = 0x02;
+    static constexpr TO_TYPE MOVED_INDEX = ~0ULL;
+
+    SwissHashSet(): _scale(0), _buckets(0), _entriesMask(0), _groupMask(0), _ctrl(nullptr), _keys(nullptr), _node(Arena::ANY) {}
+
+    // the NUMA node for the memory of the next init (Arena::ANY for no preference)
+    void place(int node) { _node = node; }
+
+    SwissHashSet& init(size_t scale=28ULL) {
+        assert(scale>2 && "scale should be at least 3");
+        _scale = std::max<size_t>(scale, __builtin_ctzll(GROUP) + 1);
+        _buckets = 1ULL << _scale;
+        _entriesMask = _buckets - 1;
+        _groupMask = _buckets / GROUP - 1;
+        assert(!_ctrl && "map already in use");
+        _ctrl = (uint8_t*)arena.map(_buckets, _node);
+        _keys = (std::atomic<uint64_t>*)arena.map(_buckets * sizeof(uint64_t), _node);
+        assert(_ctrl && _keys && "failed to mmap data");
+        return *this;
+    }
+
+    void deinit() {
+        if (_ctrl) {
+            arena.unmap(_ctrl, _buckets, _node);
+            arena.unmap(_keys, _buckets * sizeof(uint64_t), _node);
+            _ctrl = nullptr;
+            _keys = nullptr;
+        }
+    }
+
+    ~SwissHashSet() { deinit(); }
+
+    SwissHashSet& operator=(const SwissHashSet& other) = delete;
+
+    SwissHashSet& operator=(SwissHashSet&& other) {
+        deinit();
+        _scale = other._scale;
+        _buckets = other._buckets;
+        _entriesMask = other._entriesMask;
+        _groupMask = other._groupMask;
+        _ctrl = other._ctrl;
+        _keys = other._keys;
+        _node = other._node;
+        other._ctrl = nullptr;
+        other._keys = nullptr;
+        return *this;
+    }
+
+    __attribute__((always_inline))
+    bool moved(TO_TYPE e) const {
+        return e == MOVED_INDEX;
+    }
+
+    size_t capacity() const {
+        return _buckets;
+    }
+
+    __attribute__((always_inline))
+    void prefetch(uint64_t key) const {
+        __builtin_prefetch(&_ctrl[group(MurmurHash64(key)) * GROUP], 1);
+    }
+
+    // returns 0 if not found, otherwise 1 + the index of the slot
+    template<int INSERT>
+    TO_TYPE insertOrContains(uint64_t key, bool &is_new) {
+        assert(_ctrl && "storage not initialized");
+        assert(key && "cannot store 0");
+        uint64_t h = MurmurHash64(key);
+        uint8_t t = tag(h);
+        size_t g = group(h);
+
+        for (size_t probes = 0; probes <= _groupMask; probes++, g = (g + 1) & _groupMask) {
+            while (true) {
+                Group ctrl(&_ctrl[g * GROUP]);
+                if (ctrl.match(BUSY)) { // a concurrent insert, possibly of key
+                    pause();
+                    continue;
+                }
+                if (ctrl.match(MOVED)) {
+                    is_new = false;
+                    return MOVED_INDEX;
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                for (Mask m = ctrl.match(t); m; m &= m - 1) {
+                    size_t s = g * GROUP + __builtin_ctz(m);
+                    if (_keys[s].load(std::memory_order_relaxed) == key) {
+                        is_new = false;
+                        return 1 + s;
+                    }
+                }
+                Mask empty = ctrl.match(EMPTY);
+                if (!empty) break; // group is full: probe the next one
+                if (!INSERT) return 0;
+                size_t s = g * GROUP + __builtin_ctz(empty);
+                uint8_t expected = EMPTY;
+                if (__atomic_compare_exchange_n(&_ctrl[s], &expected, BUSY, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                    _keys[s].store(key, std::memory_order_relaxed);
+                    __atomic_store_n(&_ctrl[s], t, __ATOMIC_RELEASE);
+                    is_new = true;
+                    return 1 + s;
+                }
+                // lost the slot: rescan the group, the winner may have inserted key
+            }
+        }
+        printf("Hash map full! (2^%ld=%ld buckets)\n",_scale,_buckets);
+        exit(-1);
+    }
+
+    __attribute__((always_inline))
+    bool insert(uint64_t key) {
+        bool is_new;
+        insertOrContains<1>(key, is_new);
+        return is_new;
+    }
+
+    __attribute__((always_inline))
+    TO_TYPE contains(uint64_t key) {
+        bool dummy;
+        return insertOrContains<0>(key, dummy);
+    }
+
+    __attribute__((always_inline))
+    uint64_t get(TO_TYPE idx) {
+        assert(0 < idx && idx <= _buckets);
+        return _keys[idx - 1].load(std::memory_order_relaxed);
+    }
+
+    void stats() {
+        printf("...swiss table 2^%ld: ",_scale);
+        std::atomic<size_t> count(0);
+        #pragma omp parallel for
+        for (uint64_t i=0; i<_buckets; i++)
+            if (full(_ctrl[i])) count++;
+        printf("Size: %ld\n",count.load());
+    }
+
+    // also shows how many groups a successful lookup probes (if verbose)
+    void statistics(bool verbose=false) {
+        printf("...swiss table 2^%ld: ",_scale);
+        size_t count=0;
+        std::map<uint64_t,uint64_t> frequency;
+        for (uint64_t i=0; i<_buckets; i++) {
+            if (!full(_ctrl[i])) continue;
+            count++;
+            if (verbose) {
+                size_t home = group(MurmurHash64(_keys[i].load()));
+                frequency[1 + ((i / GROUP - home) & _groupMask)]++;
+            }
+        }
+        printf("Size: %ld\n",count);
+        for (auto f : frequency)
+            printf("      groups probed %ld : %ldx\n",f.first,f.second);
+    }
+
+    // Move the keys in slots [lo,hi) to the (larger) table to, leaving MOVED behind.
+    // A slot that is being claimed is only moved after its key is published.
+    void migrate(size_t lo, size_t hi, SwissHashSet& to) {
+        for (size_t i=lo; i<hi; i++) {
+            uint8_t c = __atomic_load_n(&_ctrl[i], __ATOMIC_ACQUIRE);
+            while (c == BUSY || !__atomic_compare_exchange_n(&_ctrl[i], &c, MOVED, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                if (c == BUSY) {
+                    pause();
+                    c = __atomic_load_n(&_ctrl[i], __ATOMIC_ACQUIRE);
+                }
+            }
+            if (full(c)) to.insert(_keys[i].load(std::memory_order_relaxed));
+        }
+    }
+
+    template<typename FUNC>
+    void forAll(FUNC&& func) {
+        for (TO_TYPE i = 0; i < _buckets; ++i)
+            if (full(_ctrl[i])) func(_keys[i].load(std::memory_order_relaxed));
+    }
+
+    template<typename FUNC>
+    void parallelForAll(FUNC&& func) {
+        #pragma omp parallel for
+        for (TO_TYPE i = 0; i < _buckets; ++i)
+            if (full(_ctrl[i])) func(_keys[i].load(std::memory_order_relaxed));
+    }
+
+private:
+    static bool full(uint8_t c) { return c & 0x80; }
+
+    static uint8_t tag(uint64_t h) { return 0x80 | (h >> 57); }
+
+    size_t group(uint64_t h) const { return h & _groupMask; }
+
+    static void pause() {
+#if defined(__SSE2__)
+        _mm_pause();
+#endif
+    }
+
+    // the control bytes of a group, loaded at once
+    struct Group {
+#if defined(__AVX2__)
+        __m256i g;
+        explicit Group(const uint8_t* ctrl): g(_mm256_load_si256((const __m256i*)ctrl)) {}
+        // bit i is set if control byte i equals c
+        Mask match(uint8_t c) const {
+            return _mm256_movemask_epi8(_mm256_cmpeq_epi8(g, _mm256_set1_epi8(c)));
+        }
+#elif defined(__SSE2__)
+        __m128i g;
+        explicit Group(const uint8_t* ctrl): g(_mm_load_si128((const __m128i*)ctrl)) {}
+        Mask match(uint8_t c) const {
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8(c)));
+        }
+#else
+        uint8_t g[GROUP];
+        explicit Group(const uint8_t* ctrl) {
+            for (size_t i=0; i<GROUP; i++) g[i] = __atomic_load_n(&ctrl[i], __ATOMIC_RELAXED);
+        }
+        Mask match(uint8_t c) const {
+            Mask m = 0;
+            for (size_t i=0; i<GROUP; i++) m |= Mask(g[i] == c) << i;
+            return m;
+        }
+#endif
+    };
+
+public:
+    size_t _scale;
+    size_t _buckets;     // number of slots
+    size_t _entriesMask;
+    size_t _groupMask;
+    uint8_t* _ctrl;
+    std::atomic<uint64_t>* _keys;
+    int _node;           // NUMA node of the memory, see place()
+};
+
+/*
+ * GrowingHashSet: a HashSet that starts small and grows online.
+ * Jaco van de Pol, Aarhus University, 2025
+ *
+ * When the number of keys exceeds 2^-load of the capacity, one thread allocates
+ * a table twice as large. All threads that access the set meanwhile help to
+ * migrate chunks of buckets, wait until the migration is complete, and then
+ * retry their operation on the new table. Old tables cannot be unmapped while
+ * other threads may still be probing them, so they are only released by
+ * reclaim(), which must be called when no thread accesses the set.
+ */
+
+template<typename TABLE>
+class GrowingHashSet {
+public:
+    using Table = TABLE;
+    using TO_TYPE = typename Table::TO_TYPE;
+    static constexpr size_t CHUNK = 4096; // buckets claimed per migration step
+
+    struct Migration {
+        Table* from;
+        Table* to;
+        std::atomic<size_t> claimed;
+        std::atomic<size_t> moved;
+    };
+
+    struct alignas(64) Counter { // one per thread, to avoid contention
+        std::atomic<size_t> value;
+    };
+
+    GrowingHashSet(): _table(nullptr), _migration(nullptr), _growing(false),
+                      _maxScale(0), _load(1), _threads(0), _node(Arena::ANY) {}
+
+    // the NUMA node for the memory of all tables (Arena::ANY for no preference)
+    void place(int node) { _node = node; }
+
+    GrowingHashSet& init(size_t scale=28ULL, size_t maxScale=34ULL, size_t load=1ULL) {
+        assert(!_table.load() && "map already in use");
+        Table* t = new Table();
+        t->place(_node);
+        t->init(scale);
+        _table.store(t);
+        _maxScale = std::max(scale, maxScale);
+        _load = load;
+        _threads = omp_get_max_threads();
+        _counts.reset(new Counter[_threads]);
+        for (size_t i=0; i<_threads; i++)
+            _counts[i].value.store(0, std::memory_order_relaxed);
+        return *this;
+    }
+
+    // release tables that were replaced by a migration (only when quiescent)
+    void reclaim() {
+        for (Table* t : _retired) delete t;
+        for (Migration* m : _migrations) delete m;
+        _retired.clear();
+        _migrations.clear();
+    }
+
+    void deinit() {
+        assert(!_migration.load() && "deinit during migration");
+        reclaim();
+        delete _table.exchange(nullptr);
+        _counts.reset();
+    }
+
+    ~GrowingHashSet() { deinit(); }
+
+    GrowingHashSet& operator=(const GrowingHashSet& other) = delete;
+
+    GrowingHashSet& operator=(GrowingHashSet&& other) {
+        deinit();
+        _table.store(other._table.exchange(nullptr));
+        _maxScale = other._maxScale;
+        _load = other._load;
+        _threads = other._threads;
+        _node = other._node;
+        _counts = std::move(other._counts);
+        _retired = std::move(other._retired);
+        _migrations = std::move(other._migrations);
+        return *this;
+    }
+
+    template<int INSERT>
+    TO_TYPE insertOrContains(uint64_t key, bool &is_new) {
+        while (true) {
+            Table* t = _table.load(std::memory_order_acquire);
+            if (_migration.load(std::memory_order_acquire)) {
+                help();
+                continue;
+            }
+            TO_TYPE e = t->template insertOrContains<INSERT>(key, is_new);
+            if (t->moved(e)) { // t is being migrated, retry on the new table
+                help();
+                continue;
+            }
+            if (INSERT && is_new) count(t);
+            return e;
+        }
+    }
+
+    __attribute__((always_inline))
+    bool insert(uint64_t key) {
+        bool is_new;
+        insertOrContains<1>(key, is_new);
+        return is_new;
+    }
+
+    __attribute__((always_inline))
+    TO_TYPE contains(uint64_t key) {
+        bool dummy;
+        return insertOrContains<0>(key, dummy);
+    }
+
+    // insert key with mask bits, or add them to its mask (for a Table with masks, see backmoves.h)
+    bool insert(uint64_t key, uint64_t bits) {
+        while (true) {
+            Table* t = _table.load(std::memory_order_acquire);
+            if (_migration.load(std::memory_order_acquire)) {
+                help();
+                continue;
+            }
+            bool is_new;
+            TO_TYPE e = t->insertOrMark(key, bits, is_new);
+            if (t->moved(e)) {
+                help();
+                continue;
+            }
+            if (is_new) count(t);
+            return is_new;
+        }
+    }
+
+    // number of inserted keys (exact only when quiescent)
+    size_t size() const {
+        size_t total = 0;
+        for (size_t i=0; i<_threads; i++)
+            total += _counts[i].value.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    size_t scale() const {
+        return _table.load(std::memory_order_relaxed)->_scale;
+    }
+
+    __attribute__((always_inline))
+    void prefetch(uint64_t key) const {
+        _table.load(std::memory_order_relaxed)->prefetch(key);
+    }
+
+    // only when quiescent, since the index refers to the current table
+    uint64_t get(TO_TYPE idx) { return _table.load()->get(idx); }
+
+    void stats() { _table.load()->stats(); }
+
+    void statistics(bool verbose=false) { _table.load()->statistics(verbose); }
+
+    // only when quiescent, no keys can be inserted afterwards
+    void order() { _table.load()->order(); }
+
+    template<typename FUNC>
+    void forAll(FUNC&& func) { _table.load()->forAll(func); }
+
+    template<typename FUNC>
+    void parallelForAll(FUNC&& func) { _table.load()->parallelForAll(func); }
+
+    template<typename FUNC>
+    void parallelForAllMasked(FUNC&& func) { _table.load()->parallelForAllMasked(func); }
+
+private:
+
+    // count a new key; every thread checks the load after a number of inserts
+    // such that all threads together overshoot the limit by at most 1/16
+    void count(Table* t) {
+        size_t limit = t->capacity() >> _load;
+        size_t period = std::max<size_t>(1, limit / (16 * _threads));
+        Counter& c = _counts[omp_get_thread_num() % _threads];
+        size_t local = c.value.load(std::memory_order_relaxed) + 1;
+        c.value.store(local, std::memory_order_relaxed);
+        if (local % period == 0 && size() > limit)
+            grow(t);
+    }
+
+    void grow(Table* t) {
+        if (t->_scale >= _maxScale) return; // keep filling the largest table
+        if (_growing.exchange(true, std::memory_order_acq_rel)) {
+            // another thread is growing t: wait for it, since that thread may be
+            // descheduled, while the others would keep filling t beyond its limit
+            while (_growing.load(std::memory_order_acquire) && _table.load(std::memory_order_acquire) == t) {
+                help();
+                std::this_thread::yield();
+            }
+            return;
+        }
+        if (_table.load(std::memory_order_acquire) != t) { // someone else was first
+            _growing.store(false, std::memory_order_release);
+            return;
+        }
+        Migration* m = new Migration();
+        m->from = t;
+        m->to = new Table();
+        m->to->place(_node);
+        m->to->init(t->_scale + 1);
+        m->claimed.store(0, std::memory_order_relaxed);
+        m->moved.store(0, std::memory_order_relaxed);
+        _migration.store(m, std::memory_order_release);
+        help();
+    }
+
+    // claim chunks of the current migration until none are left, then wait until it is finished
+    void help() {
+        Migration* m = _migration.load(std::memory_order_acquire);
+        if (!m) return;
+        size_t buckets = m->from->_buckets;
+        size_t lo;
+        while ((lo = m->claimed.fetch_add(CHUNK)) < buckets) {
+            size_t hi = std::min(lo + CHUNK, buckets);
+            m->from->migrate(lo, hi, *m->to);
+            if (m->moved.fetch_add(hi - lo) + (hi - lo) == buckets)
+                finish(m);
+        }
+        while (_table.load(std::memory_order_acquire) == m->from)
+            std::this_thread::yield();
+    }
+
+    // executed by the thread that migrated the last chunk
+    void finish(Migration* m) {
+        _retired.push_back(m->from);
+        _migrations.push_back(m);
+        _table.store(m->to, std::memory_order_release);
+        _migration.store(nullptr, std::memory_order_release);
+        _growing.store(false, std::memory_order_release);
+    }
+
+    std::atomic<Table*> _table;
+    std::atomic<Migration*> _migration;
+    std::atomic<bool> _growing;
+    size_t _maxScale;
+    size_t _load;
+    size_t _threads;
+    int _node;
+    std::unique_ptr<Counter[]> _counts;
+    std::vector<Table*> _retired;
+    std::vector<Migration*> _migrations;
 };
@@ -0,0 +1,113 @@
+/*
+ * Jaco van de Pol, Aarhus University, 2025
+ *
+ * CanonTable: the canonical forms of all NxN matrices, for N<=5 (LOOKUP>=1).
+ *
+ * A matrix of N<=5 has at most 25 bits, so a table indexed by the raw matrix can
+ * hold its canonical form, its number of automorphisms and the permutation to its
+ * canonical form, in 2^(N*N) words (256MB for N=5). Canonicalization is then a
+ * single memory access, also for the trace-back of many goals.
+ * The table is built in parallel at startup, per orbit: the first matrix x of an
+ * orbit is canonicalized once, with permutation pi, and every sigma . x gets the
+ * same canonical form and the permutation sigma^-1 . pi, for all N! permutations
+ * sigma. Threads that reach the same orbit at the same time write the same forms.
+ * Most of the time goes to writing the entries at random places, so for many short
+ * runs (LOOKUP=2) the table is saved to a file by the first run, and loaded by the
+ * next ones. A loaded table is checked on a sample of matrices.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include "matrix.h"
+
+class CanonTable {
+public:
+    static constexpr uint64_t SIZE = 1ULL << (N*N);
+
+    // fill the table: canon(y, pi) sets pi to the permutation from y to its canonical
+    // form, sets y to that form, and returns its number of automorphisms
+    template<typename CANON>
+    void build(CANON&& canon) {
+        _table.reset(new uint64_t[SIZE]());
+        #pragma omp parallel for schedule(dynamic, 1024)
+        for (uint64_t x=0; x<SIZE; x++) {
+            if (__atomic_load_n(&_table[x], __ATOMIC_RELAXED)) continue; // orbit done
+            matrix y = x;
+            perm pi;
+            uint64_t aut = canon(y, pi);
+            perm sigma, sigma_inv, pi2;
+            for (uint64_t s=0; s<fac[N]; s++) {
+                nth_perm(s, sigma);
+                inv_perm(sigma, sigma_inv);
+                compose_perm(pi, sigma_inv, pi2); // from sigma . x to y
+                __atomic_store_n(&_table[permute(x, sigma)], entry(y, aut, pi2), __ATOMIC_RELAXED);
+            }
+        }
+    }
+
+    // read the table from file, and check it with canon on a sample; return success
+    template<typename CANON>
+    bool load(const std::string &file, CANON&& canon) {
+        std::ifstream input(file, std::ios::binary);
+        if (!input.is_open()) return false;
+        _table.reset(new uint64_t[SIZE]);
+        input.read(reinterpret_cast<char*>(_table.get()), SIZE * sizeof(uint64_t));
+        if (!input || input.peek() != EOF) return false;
+        for (uint64_t x=1; x<SIZE; x = x * 3 + 1) { // a sample of all sizes
+            matrix y = x, z = x;
+            perm pi;
+            if (canon(y, pi) != lookup(z) || y != z) return false;
+        }
+        return true;
+    }
+
+    void save(const std::string &file) const {
+        std::ofstream output(file, std::ios::binary);
+        output.write(reinterpret_cast<const char*>(_table.get()), SIZE * sizeof(uint64_t));
+        if (!output) std::cerr << "Could not write canonical table: " << file << "\n";
+    }
+
+    // set y to its canonical form and return its number of automorphisms
+    uint64_t lookup(matrix &y) const {
+        uint64_t e = _table[y];
+        y = e & MATRIX;
+        return (e >> 32) & 0xFF;
+    }
+
+    // set pi to the permutation from x to its canonical form
+    void permutation(matrix x, perm pi) const {
+        uint64_t e = _table[x] >> 40;
+        for (byte i=0; i<N; i++, e >>= 3) pi[i] = e & 7;
+    }
+
+private:
+    static constexpr uint64_t MATRIX = SIZE - 1;
+
+    // the permutation with number s < N! (in the factorial number system)
+    static void nth_perm(uint64_t s, perm sigma) {
+        byte unused[N];
+        id_perm(unused);
+        for (byte i=0; i<N; i++) {
+            uint64_t k = s / fac[N-1-i];
+            s %= fac[N-1-i];
+            sigma[i] = unused[k];
+            for (byte j=k; j+1<N-i; j++) unused[j] = unused[j+1];
+        }
+    }
+
+    // bits 0..24: the canonical form, 32..39: automorphisms (at most 5! = 120),
+    // 40..54: the permutation, 3 bits per index; 0 is the empty entry
+    static uint64_t entry(matrix y, uint64_t aut, const perm pi) {
+        uint64_t e = y | aut << 32;
+        for (byte i=0; i<N; i++) e |= uint64_t(pi[i]) << (40 + 3*i);
+        return e;
+    }
+
+    std::unique_ptr<uint64_t[]> _table;
+};
+
+inline CanonTable canonTable; // shared by all levels
@@ -3,6 +3,10 @@
 
 #include "options.h"
 #include <cstdint>
+#include <utility>
+#if KERNEL==1
+#include "bitmatrix.h"
+#endif
 
 typedef uint8_t byte;
 typedef uint64_t matrix;    // store at most 8x8 Booleans
@@ -48,11 +52,72 @@ matrix read_matrix(std::string filename) {
     return result;
 }
 
+// the number of successors of a matrix: add row i to row j, for i != j
+const size_t MOVES = N*(N-1);
+const uint64_t ALL_MOVES = (1ULL << MOVES) - 1; // as bits, in the order of canonical_successors
+
+// the bit of move (i,j) in a set of moves
+inline byte move_index(byte i, byte j) { return i*(N-1) + (j < i ? j : j-1); }
+
+// the bit of move (j,i), for the bit m of move (i,j)
+inline byte reverse_move(byte m) {
+    const byte ROWS = N > 1 ? N-1 : 1; // N=1 has no moves, but should not divide by 0
+    byte i = m / ROWS, j = m % ROWS;
+    return move_index(j < i ? j : j+1, i);
+}
+
+// left-multiply x with the elementary matrix that adds row i to row j
+inline matrix successor(matrix x, byte i, byte j) {
+    uint64_t mask = (1UL<<N*(i+1)) - (1UL<<N*i);
+    uint64_t row = (x & mask) >> i*N;
+    return x ^ (row << j*N);
+}
+
+// the transpose of x: y[i][j] := x[j][i]
+inline matrix transpose(matrix x) {
+#if KERNEL==1
+    return bitmatrix::from_stride8(bitmatrix::transpose8(bitmatrix::to_stride8(x)));
+#else
+    matrix y = 0;
+    for (byte i=0; i<N; i++)
+        for (byte j=0; j<N; j++)
+            y |= ((x >> (N*j + i)) & 1) << (N*i + j);
+    return y;
+#endif
+}
+
+// the inverse of the invertible x, by Gauss-Jordan elimination on the rows of (x | id)
+inline matrix inverse(matrix x) {
+    const matrix ROW = (1ULL << N) - 1;
+    uint16_t a[N], b[N];
+    for (byte i=0; i<N; i++) {
+        a[i] = (x >> N*i) & ROW;
+        b[i] = 1U << i;
+    }
+    for (byte c=0; c<N; c++) {
+        byte p = c;
+        while (!((a[p] >> c) & 1)) p++; // a pivot exists, since x is invertible
+        std::swap(a[c], a[p]);
+        std::swap(b[c], b[p]);
+        for (byte r=0; r<N; r++)
+            if (r != c && ((a[r] >> c) & 1)) {
+                a[r] ^= a[c];
+                b[r] ^= b[c];
+            }
+    }
+    matrix y = 0;
+    for (byte i=0; i<N; i++) y |= matrix(b[i]) << N*i;
+    return y;
+}
+
 // Apply the permutation pi to both rows and columns of x
 // The result y is defined by y[i][j] := x[pi[i]][pi[j]]
 // NOTE: since we permute indices, we actually apply the inverse of pi.
 // This makes a difference when composing permutations.
 inline matrix permute(matrix x, const perm pi) {
+#if KERNEL==1
+    return bitmatrix::permute(x, pi, pi);
+#else
     matrix y = 0;
     for (byte i=N-1; i<N; i--)
         for (byte j=N-1; j<N; j--) {
@@ -60,6 +125,7 @@ inline matrix permute(matrix x, const perm pi) {
             y |= (x >> (pi[i]*N + pi[j])) & 1;
         }
     return y;
+#endif
 }
 
 // return the identity permutation in pi
@@ -90,6 +156,9 @@ inline void compose_inv_perm(const perm pi1, const perm pi2, perm pi) {
 // Define y by y[i][j] := x[pi1[i]][pi2[j]]
 // NOTE: also here, we permute indices, so we actually apply the inverse of pi1 and pi2
 matrix permute2(matrix x, const perm pi1, const perm pi2) {
+#if KERNEL==1
+    return bitmatrix::permute(x, pi1, pi2);
+#else
     matrix y = 0;
     for (byte i=N-1; i<N; i--)
         for (byte j=N-1; j<N; j--) {
@@ -97,6 +166,7 @@ matrix permute2(matrix x, const perm pi1, const perm pi2) {
             y |= (x >> (pi1[i]*N + pi2[j])) & 1;
         }
     return y;
+#endif
 }
 
 #if POLY==1 && GOAL==0
@@ -10,7 +10,21 @@
 #include <vector>
 #include <omp.h>
 #include "hashset.h" // thread-safe hash set from dtree project
-#include "options.h" // defines N,E,MAX,SWAP,NAUTY,POLY,BEAT, see also matrix_cnot.sh
+#include "frozenset.h" // succinct static set for completed levels
+#include "visited.h" // single table for all levels, tagged with depth
+#include "sharded.h" // level tables split into shards, possibly on NUMA nodes
+#include "filter.h" // Bloom filters for completed levels
+#include "cache.h" // per-thread cache of canonical forms
+#include "options.h" // defines N,E,MAX,BATCH,GLOBAL,GROW,COMPACT,SWISS,FREEZE,ORDERED,FILTER,ARENA,SHARDS,NUMA,CACHE,KERNEL,SIMD,LOOKUP,PRUNE,INVERSE,ORDERLY,BACK,DENSE,SWAP,NAUTY,POLY,BEAT, see also matrix_cnot.sh
+#if NAUTY==2
+#include "repr_hybrid.h" // nauty for matrices with large finger-print cells
+#endif
+#if BACK==1
+#include "backmoves.h" // level tables with the moves back into the previous level
+#endif
+#if DENSE==1
+#include "dense.h" // all matrices, ranked, with 2 bits for their depth
+#endif
 #include "timing.h"
 #include "matrix.h"
 #include "repr.h"
@@ -18,6 +32,7 @@
 
 // precalculated 2-log of the orbit level sizes (0-terminated)
 // NOTE: the size depends on if SWAPs are free or not
+// NOTE: with GROW==1 these are not used: tables start small and grow on demand
 
 #if SWAP==0
 const std::array<std::vector<byte>,9> levelSizes = {{
@@ -52,41 +67,199 @@ std::array<std::atomic<uint64_t>,N+1>poly; // coefficients of the polynomial at
 #endif
 
 hashset bfs_levels[3*N];    // for one-directional BFS
-hashset bfs_fwd[(3*N+2)/2]; // for bi-directional BFS
-hashset bfs_bwd[(3*N+1)/2];
+hashset bfs_fwd[3*N]; // for bi-directional BFS
+hashset bfs_bwd[3*N]; // (the smallest side is expanded, so either can get deep)
 
-void Add(matrix x, byte i, byte j, 
-            hashset *prev, hashset *current, hashset *next, int depth,
-            uint64_t &level, uint64_t &count) {
-    uint64_t mask = (1UL<<N*(i+1)) - (1UL<<N*i);
-    uint64_t row = (x & mask) >> i*N;
-    matrix y = x ^ (row << j*N);
-    uint64_t Orbit = representative(y);
-    if (!prev->contains(y) && !current->contains(y) && next->insert(y)) {
-        // only insert and count if new; 
-        level += Orbit;
-        count++;
+// count the new canonical matrix y with aut automorphisms
+// (dual: in the group with inverse and transpose, see dual_aut)
+inline void Count(matrix y, uint64_t aut, int depth,
+            uint64_t &level, uint64_t &count, bool dual) {
+    // only the new matrices need their orbit size
+#if INVERSE>=1
+    uint64_t Orbit = dual ? dual_orbit_size(aut) : orbit_size(aut);
+#else
+    uint64_t Orbit = orbit_size(aut);
+#endif
+    level += Orbit;
+    count++;
 #if POLY==1
-        if (2*(depth-1)==N) {
-            byte ess = countEssential(y);
-            poly[N-ess] += Orbit * (fac[ess] * fac[N-ess]) / fac[N];
-        }
+    if (2*(depth-1)==N) {
+        byte ess = countEssential(y);
+        poly[N-ess] += Orbit * (fac[ess] * fac[N-ess]) / fac[N];
+    }
+#endif
+}
+
+// insert the canonical matrix y with aut automorphisms, if it is new
+// (with BACK=1 also if it is in next already, marked with back: its move into current)
+inline void Visit(matrix y, uint64_t aut, uint64_t back,
+            hashset *prev, hashset *current, hashset *next, int depth,
+            uint64_t &level, uint64_t &count, bool dual) {
+#if GLOBAL==1
+    if (next->insert(y)) // fails if y is in any level, including prev and current
+#elif BACK==1
+    if (!prev->contains(y) && !current->contains(y) && next->insert(y, back))
+#else
+    if (!prev->contains(y) && !current->contains(y) && next->insert(y))
+#endif
+        Count(y, aut, depth, level, count, dual);
+}
+
+// the successors of x, in the larger group if dual; with BACK=1 except by the moves in
+// skip (they lead into prev), and with the moves of the successors back to x in back
+inline size_t successors(matrix x, matrix succ[], uint64_t aut[], bool dual,
+            uint64_t skip=0, uint64_t back[]=nullptr) {
+#if INVERSE>=1
+    if (dual) return dual_successors(x, succ, aut);
+#endif
+    Parent p(x);
+#if BACK==1
+    backStats.count(p.moves, skip);
+    p.moves &= ~skip;
+#endif
+    return canonical_successors(p, succ, aut, back);
+}
+
+void Expand(matrix x, uint64_t skip,
+            hashset *prev, hashset *current, hashset *next, int depth,
+            uint64_t &level, uint64_t &count, bool dual) {
+    matrix succ[SUCCESSORS];
+    uint64_t aut[SUCCESSORS], back[SUCCESSORS] = {};
+    size_t size = successors(x, succ, aut, dual, skip, back);
+    for (size_t k=0; k<size; k++)
+        Visit(succ[k], aut[k], back[k], prev, current, next, depth, level, count, dual);
+}
+
+#if ORDERLY==1
+// the canonical parent of the new canonical y: its first row operation into the current
+// level (there is one, also if dual, as for step_back)
+inline matrix canonical_parent(matrix y, hashset *current, bool dual) {
+    matrix parent = first_successor(Parent(y), [&](matrix &z, uint64_t aut) {
+#if INVERSE>=1
+        if (dual) dual_aut(z, aut);
 #endif
+        return current->contains(z);
+    });
+    assert(parent && "Parent not found");
+    return parent;
+}
+
+// Orderly generation: a new matrix y is only generated by its canonical parent, so every
+// matrix of the next level is generated once, and the next level needs no concurrent
+// table to remove duplicates. Instead, the row operations of y are canonicalized and
+// looked up in the (read-only) current level until the parent is found, which costs
+// more than the inserts. The new matrices are appended to the buffer out of the thread
+// (if not null), to be inserted or frozen after the level.
+void ExpandOrderly(matrix x,
+            hashset *prev, hashset *current, std::vector<uint64_t> *out, int depth,
+            uint64_t &level, uint64_t &count, bool dual) {
+    std::pair<matrix,uint64_t> succ[SUCCESSORS]; // with their automorphisms
+    matrix s[SUCCESSORS];
+    uint64_t aut[SUCCESSORS];
+    size_t size = successors(x, s, aut, dual);
+    for (size_t k=0; k<size; k++) succ[k] = {s[k], aut[k]};
+    std::sort(succ, succ + size); // different moves may give the same successor
+    for (size_t k=0; k<size; k++) {
+        matrix y = succ[k].first;
+        if ((k > 0 && y == succ[k-1].first) || prev->contains(y) || current->contains(y))
+            continue;
+        if (canonical_parent(y, current, dual) != x) continue;
+        if (out) out->push_back(y);
+        Count(y, succ[k].second, depth, level, count, dual);
+    }
+}
+#endif
+
+#if BATCH>0
+// A block of frontier elements, whose successors are expanded together:
+// first all successors are canonicalized, then their buckets are probed,
+// while the buckets of the successors PREFETCH positions ahead are prefetched.
+// This keeps many cache misses in flight, instead of waiting for each probe.
+struct Block {
+    static constexpr size_t PREFETCH = 16;
+    matrix frontier[BATCH];
+    uint64_t skip[BATCH];  // the moves into prev, with BACK=1
+    size_t size = 0;
+    matrix succ[BATCH*SUCCESSORS];
+    uint64_t aut[BATCH*SUCCESSORS];
+    uint64_t back[BATCH*SUCCESSORS] = {};
+};
+
+inline void prefetch(matrix y, hashset *prev, hashset *current, hashset *next) {
+#if GLOBAL==0
+    prev->prefetch(y);
+    current->prefetch(y);
+#endif
+    next->prefetch(y);
+}
+
+void expand_block(Block &b,
+            hashset *prev, hashset *current, hashset *next, int depth,
+            uint64_t &level, uint64_t &count, bool dual) {
+    size_t m = 0;
+    for (size_t k=0; k<b.size; k++)
+        m += successors(b.frontier[k], b.succ + m, b.aut + m, dual, b.skip[k], b.back + m);
+    for (size_t k=0; k<std::min(m, Block::PREFETCH); k++)
+        prefetch(b.succ[k], prev, current, next);
+    for (size_t k=0; k<m; k++) {
+        if (k + Block::PREFETCH < m)
+            prefetch(b.succ[k + Block::PREFETCH], prev, current, next);
+        Visit(b.succ[k], b.aut[k], b.back[k], prev, current, next, depth, level, count, dual);
     }
+    b.size = 0;
+}
+#endif
+
+// 2-log of the largest table: MAX applies to every shard
+const int MAXTABLE = MAX + __builtin_ctz(SHARDS);
+
+// 2-log of the initial table for the next level, given the current level
+inline byte table_size(byte depth, uint64_t orbit) {
+#if GROW==1
+    byte log = 64 - __builtin_clzll(orbit | 1); // the next level is typically larger
+    return std::min(std::max(log + E, 3), MAXTABLE);
+#else
+    return std::min(std::max(levelSizes[N][depth-2] + E, 3), MAXTABLE);
+#endif
+}
+
+void new_level(hashset levels[], byte depth, byte tableSize) {
+#if ORDERLY==1 && FREEZE==1
+    tableSize = 3; // the level is frozen from the generated matrices, see next_level
+#endif
+#if GLOBAL==1
+    if (depth > 0) { // all levels share the table of level 0
+        levels[depth].attach(levels[depth-1], depth);
+        return;
+    }
+#endif
+    levels[depth] = hashset();
+#if GROW==1
+    levels[depth].init(tableSize, MAX, E);
+#else
+    levels[depth].init(tableSize);
+#endif
 }
 
-uint64_t init_level(hashset levels[], matrix start) {
-    levels[0] = hashset(); // level 0 (prev)
-    levels[0].init(3);
-    levels[1] = hashset(); // level 1 (current)
-    levels[1].init(3);
-    uint64_t Orbit = representative(start); // modifies start
+uint64_t init_level(hashset levels[], matrix start, bool dual) {
+    new_level(levels, 0, 3); // level 0 (prev)
+    new_level(levels, 1, 3); // level 1 (current)
+#if INVERSE>=1
+    uint64_t Orbit = dual ? dual_canonical(start) : canonical(start); // modifies start
+#else
+    uint64_t Orbit = canonical(start); // modifies start
+#endif
     levels[1].insert(start);
+#if FREEZE==1
+    levels[0].freeze();
+    levels[1].freeze();
+#endif
     return Orbit;
 }
 
-// explore and count all successors of the current level
-uint64_t next_level(uint64_t &size, hashset levels[], uint32_t depth) { 
+// explore and count all successors of the current level (in the larger group if dual);
+// with ORDERLY=1 and not store, the new matrices are counted but not kept
+uint64_t next_level(uint64_t &size, hashset levels[], uint32_t depth, bool dual, bool store) {
     std::atomic<uint64_t> level(0);
     std::atomic<uint64_t> count(0);
 
@@ -97,12 +270,27 @@ uint64_t next_level(uint64_t &size, hashset levels[], uint32_t depth) {
     auto current = &levels[depth-1];
     auto next = &levels[depth];
 
-    current->parallelForAll(
-        [&](matrix x){
+#if ORDERLY==1
+    std::vector<std::vector<uint64_t>> generated(omp_get_max_threads()); // one per thread
+#elif BATCH>0
+    std::vector<Block> blocks(omp_get_max_threads()); // one per thread
+#endif
+
+    // x with skip: its moves into prev (BACK=1)
+    auto expand = [&](matrix x, uint64_t skip){
             uint64_t loc_level=0, loc_count=0;
-            for (byte i=0; i<N; i++)
-                for (byte j=0; j<N; j++) // add to row j
-                    if (i != j) Add(x, i, j, prev, current, next, depth, loc_level, loc_count);
+#if ORDERLY==1
+            std::vector<uint64_t> *out = store ? &generated[omp_get_thread_num()] : nullptr;
+            ExpandOrderly(x, prev, current, out, depth, loc_level, loc_count, dual);
+#elif BATCH>0
+            Block &b = blocks[omp_get_thread_num()];
+            b.skip[b.size] = skip;
+            b.frontier[b.size++] = x;
+            if (b.size == BATCH)
+                expand_block(b, prev, current, next, depth, loc_level, loc_count, dual);
+#else
+            Expand(x, skip, prev, current, next, depth, loc_level, loc_count, dual);
+#endif
         if (loc_level > 0) {
             level += loc_level;
             count += loc_count;
@@ -117,7 +305,41 @@ uint64_t next_level(uint64_t &size, hashset levels[], uint32_t depth) {
             lifeTime[worker] = system_clock::now();
         }
 #endif
-    });
+    };
+#if BACK==1
+    current->parallelForAllMasked(expand);
+#else
+    current->parallelForAll([&](matrix x){ expand(x, 0); });
+#endif
+#if ORDERLY==1 && FREEZE==0
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (size_t t=0; t<generated.size(); t++) { // the inserts are new, without contention
+        for (uint64_t y : generated[t]) next->insert(y);
+        std::vector<uint64_t>().swap(generated[t]);
+    }
+#elif ORDERLY==0 && BATCH>0
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (size_t t=0; t<blocks.size(); t++) { // expand the partial blocks
+        uint64_t loc_level=0, loc_count=0;
+        expand_block(blocks[t], prev, current, next, depth, loc_level, loc_count, dual);
+        level += loc_level;
+        count += loc_count;
+    }
+#endif
+#if GROW==1
+    next->reclaim(); // all threads have left the replaced tables
+#endif
+#if ORDERED==1
+    next->order(); // from now on, next is only read
+#endif
+#if FREEZE==1 && ORDERLY==1
+    next->freeze(generated); // directly from the generated matrices, the live table is empty
+#elif FREEZE==1
+    next->freeze(); // from now on, next is only read
+#endif
+#if FILTER>0
+    next->filter(count, FILTER); // lookups in next are mostly unsuccessful
+#endif
     size = count;
     return level;
 }
@@ -130,21 +352,20 @@ int generate_bfs(matrix start, matrix goal, byte limit, hashset bfs_levels[]) {
     orbit = orbits = 1;
 
     printf("Depth 0 (2^3): "); fflush(stdout);
-    levels = level = init_level(bfs_levels, start);
+    levels = level = init_level(bfs_levels, start, INVERSE>=1);
 
     while (orbit) {
         report(level, orbit);
         if (goal)
-            { if (find_level(goal, bfs_levels[depth])) return -depth; }
+            { if (find_level(goal, bfs_levels[depth], INVERSE>=1)) return -depth; }
         else 
             { if (depth > 1) bfs_levels[depth-2].deinit(); }
         if (depth-1 == limit) return depth;
         depth++;
-        tableSize = std::min(std::max(levelSizes[N][depth-2] + E, 3), MAX);
-        bfs_levels[depth] = hashset();
-        bfs_levels[depth].init(tableSize);
+        tableSize = table_size(depth, orbit);
+        new_level(bfs_levels, depth, tableSize);
         printf("Depth %u (2^%u): ", depth-1, tableSize); fflush(stdout);
-        levels += level = next_level(orbit, bfs_levels, depth);
+        levels += level = next_level(orbit, bfs_levels, depth, INVERSE>=1, goal || depth-1 != limit);
         orbits += orbit;
     }
     depth--;
@@ -158,7 +379,37 @@ int generate_bfs(matrix start, matrix goal, byte limit, hashset bfs_levels[]) {
     return depth;
 }
 
+#if DENSE==1
+// BFS over all of GL(N,2), without symmetries, to check the level sizes of generate_bfs
+int generate_dense(matrix start, byte limit) {
+    DistanceArray distance; // about 5 GB for N=6
+    byte depth = 0;
+    uint64_t level, levels, unvisited;
+    levels = level = 1;
+    unvisited = dense::STATES - 1;
+    distance.visit(dense::rank(start), 0);
+
+    printf("Depth 0 (dense): "); fflush(stdout);
+    while (level) {
+        std::cout << "(" << currentTime() << "s) (" << level << " elts)" << std::endl;
+        if (depth == limit) return depth;
+        depth++;
+        bool bottomUp = level > unvisited / dense::BOTTOM_UP; // the frontier dominates
+        printf("Depth %u (%s): ", depth, bottomUp ? "bottom-up" : "top-down"); fflush(stdout);
+        levels += level = bottomUp ? distance.bottom_up(depth) : distance.top_down(depth);
+        unvisited -= level;
+    }
+    printf("--\n");
+    printf("Total size: %lu (of %lu matrices), completed at depth %u\n", levels, dense::STATES, depth-1);
+    return depth;
+}
+#endif
+
 matrix intersect(hashset &L1, hashset &L2) {
+#if FREEZE==1
+    if (L1.frozen() && L2.frozen()) // parallel sorted merge
+        return intersect(L1.frozenSet(), L2.frozenSet());
+#endif
     std::atomic<matrix> joint(0);
     L1.parallelForAll([&](matrix x){
         if (L2.contains(x)) joint=x; // How to terminate when found?
@@ -166,6 +417,22 @@ matrix intersect(hashset &L1, hashset &L2) {
     return joint;
 }
 
+// a matrix of the Bwd level whose orbit is in the Fwd level; with INVERSE=1 the Fwd
+// levels hold canonical forms of the larger group, to which the Bwd matrices are mapped
+matrix meet(hashset &fwd, hashset &bwd) {
+#if INVERSE>=1
+    std::atomic<matrix> joint(0);
+    bwd.parallelForAll([&](matrix x){
+        matrix y = x;
+        dual_canonical(y);
+        if (fwd.contains(y)) joint=x;
+    });
+    return joint;
+#else
+    return intersect(fwd, bwd);
+#endif
+}
+
 // Bidirectional search yields a matrix in the intersection of Fwd(start) and Bwd(goal)
 // We also return the depths of the fwd and bwd search (fdepth,bdepth)
 // We return (0,fdepth,bdepth) if start and goal are not connected
@@ -181,38 +448,40 @@ triple bidirectional(matrix start, matrix goal, byte limit, hashset bfs_fwd[], h
     byte fdepth = 1, bdepth=1, tableSize;
     uint64_t level, forbit, borbit, levels, orbits;
     forbit = borbit = 1; orbits = 2;
-    levels = level = init_level(bfs_fwd, start);
+    levels = level = init_level(bfs_fwd, start, INVERSE>=1);
     printf("Fwd Depth 0 (2^3): "); report(level, forbit);
-    levels += level = init_level(bfs_bwd, goal);
+    levels += level = init_level(bfs_bwd, goal, false);
     printf("Bwd Depth 0 (2^3): "); report(level, borbit);
-    matrix m = intersect(bfs_fwd[fdepth], bfs_bwd[bdepth]);
+    matrix m = meet(bfs_fwd[fdepth], bfs_bwd[bdepth]);
     if (m) return Triple(m, fdepth, bdepth);
 
     while (fdepth + bdepth - 2 < 3*(N-1)) { // expand the smallest level
         if (fdepth+bdepth-2 == limit) return Triple(m, fdepth, bdepth);
         if (forbit <= borbit) {
             fdepth++; 
-            tableSize = std::min(std::max(levelSizes[N][fdepth-2] + E, 3), MAX);
+            tableSize = table_size(fdepth, forbit);
             printf("Fwd Depth %u (2^%u): ", fdepth-1, tableSize); fflush(stdout);
-            bfs_fwd[fdepth] = hashset();
-            bfs_fwd[fdepth].init(tableSize);
-            levels += level = next_level(forbit, bfs_fwd, fdepth);
+            new_level(bfs_fwd, fdepth, tableSize);
+            levels += level = next_level(forbit, bfs_fwd, fdepth, INVERSE>=1, true);
             orbits += forbit;
             report(level, forbit);
         }
         else {
             bdepth++;
+#if GROW==1
+            tableSize = table_size(bdepth, borbit);
+#else
             // Note: this Bwd level is smaller than next Fwd one
             // Problem: Bwd's successor can still be larger than Fwd's successor (hence 10)
-            tableSize = std::min(std::max(levelSizes[N][fdepth-1] + E, 10), MAX); 
+            tableSize = std::min(std::max(levelSizes[N][fdepth-1] + E, 10), MAXTABLE); 
+#endif
             printf("Bwd Depth %u (2^%u): ", bdepth-1, tableSize); fflush(stdout);
-            bfs_bwd[bdepth] = hashset();
-            bfs_bwd[bdepth].init(tableSize);
-            levels += level = next_level(borbit, bfs_bwd, bdepth);
+            new_level(bfs_bwd, bdepth, tableSize);
+            levels += level = next_level(borbit, bfs_bwd, bdepth, false, true);
             orbits += borbit;
             report(level, borbit);
         }
-        m = intersect(bfs_fwd[fdepth], bfs_bwd[bdepth]);
+        m = meet(bfs_fwd[fdepth], bfs_bwd[bdepth]);
         if (m) return Triple(m, fdepth, bdepth);
     }
     printf("Not found at distance %u+%u (%lu, %lu)\n", fdepth-1, bdepth-1, levels, orbits);
@@ -224,10 +493,10 @@ triple bidirectional(matrix start, matrix goal, byte limit, hashset bfs_fwd[], h
  */
 
 int main(int argc, char const *argv[]) {
-#if NAUTY==1
+#if NAUTY>=1
     nauty_check(WORDSIZE,m,n,NAUTYVERSIONID);
     options.getcanon=true;   // we want the canonical graph
-    options.defaultptn=true; // default coloring
+    options.defaultptn=false; // we color the vertices, see NautyWork
 #endif
     if (N<1 || N>8) {
         printf("N={%u} not supported, only N=1..8\n", N);
@@ -237,12 +506,30 @@ int main(int argc, char const *argv[]) {
         printf("Polynomial coefficients are not supported with SWAP\n");
         exit(-1);
     }
+    arena.enable(ARENA==1);
+    arena.place(Arena::Placement(NUMA));
+    canonCache.init(CACHE);
     printf("Handling matrices of size N = %u\n", N);
-    printf("Using DTree + %u extra bits, max-size %u\n", E, MAX);
-    printf("Use Nauty: %u. Swaps-for-free: %u. Polynomial: %u\n", NAUTY, SWAP, POLY);
+    printf("Using DTree + %u extra bits, max-size %u, growing: %u, compact: %u, swiss: %u, freeze: %u, ordered: %u, filter: %u, arena: %u, shards: %u, numa: %u, global: %u, batch: %u, cache: %u, simd: %u, prune: %u, orderly: %u, back: %u, dense: %u\n", E, MAX, GROW, COMPACT, SWISS, FREEZE, ORDERED, FILTER, ARENA, SHARDS, NUMA, GLOBAL, BATCH, CACHE, SIMD, PRUNE, ORDERLY, BACK, DENSE);
+    printf("Use Nauty: %u. Swaps-for-free: %u. Polynomial: %u. Inverse: %u\n", NAUTY, SWAP, POLY, INVERSE);
+#if KERNEL==1
+    printf("Bit-matrix kernel: %s\n", bitmatrix::kernel_name());
+#endif
     #if defined(_OPENMP)
         printf("Running with %d OpenMP threads\n",omp_get_max_threads());
+        if (omp_get_proc_bind() != omp_proc_bind_false)
+            printf("Threads bound to %d places, on %d NUMA nodes\n", omp_get_num_places(), Arena::nodes());
     #endif
+#if LOOKUP>=1
+    auto tableStart = steady_clock::now();
+    const char* filled = init_table();
+    printf("Canonical table of 2^%u matrices %s in %.2fs (%lu MB)\n", N*N, filled,
+        duration<double>(steady_clock::now() - tableStart).count(), (CanonTable::SIZE * 8) >> 20);
+#if NAUTY==2 // the level reports only count the canonicalizations of the BFS, not of the table
+    hybridStats.take(HybridStats::SEARCH);
+    hybridStats.take(HybridStats::NAUTY_CELLS);
+#endif
+#endif
 
     matrix id=1; // compute identity matrix
     for (byte i=1; i<N; i++) id = (id << (N+1)) | 1;
@@ -259,28 +546,46 @@ int main(int argc, char const *argv[]) {
         //investigate(goal);
         assert(goal!=0 && "0-matrix cannot be generated");
     }
+    if (DENSE==1 && goal) {
+        printf("The dense BFS does not support a goal\n");
+        exit(-1);
+    }
     if (goal) {
-        triple m = bidirectional(id, goal, limit, bfs_fwd, bfs_bwd);
+        matrix search = goal; // the goal, or a variant of it with INVERSE=1
+#if INVERSE>=1
+        const char* variants[4] = {"goal", "inverse", "transpose", "inverse transpose"};
+        byte variant = dual_goal(goal);
+        search = dual(goal, variant);
+        printf("Searching backward from the %s\n", variants[variant]);
+#endif
+        triple m = bidirectional(id, search, limit, bfs_fwd, bfs_bwd);
         matrix middle = m.first;
         int fdepth = m.second.first;
         int bdepth = m.second.second;
         if (m.first) {
             printf("Found at distance %u (%u + %u)\n", fdepth + bdepth - 2, fdepth-1, bdepth-1);
             perm pi;
-            trace concat = trace_back_middle(id, middle, goal, bfs_fwd, bfs_bwd, fdepth, bdepth, pi);
+            trace concat = trace_back_middle(id, middle, search, bfs_fwd, bfs_bwd, fdepth, bdepth, pi);
+#if INVERSE>=1
+            concat = dual_trace(concat, variant); // pi is the identity
+#endif
             print_trace(id, goal, concat, pi);
         } else {
             printf("Goal not found after %d steps: \n", fdepth+bdepth-2);
             pretty_matrix(goal);
         }
     } else {
+#if DENSE==1
+        int depth = generate_dense(id, limit);
+#else
         int depth = generate_bfs(id, goal, limit, bfs_levels); 
+#endif
         if (goal) { // currently unreachable, since bidirectional is preferred
             if (depth < 0) { // negative means goal is found 
                 depth = -depth;
                 printf("Goal found at level %d\n", depth-1);
                 trace bfs_trace;
-                matrix other = trace_back(goal, bfs_levels, depth, bfs_trace);
+                matrix other = trace_back(goal, bfs_levels, depth, bfs_trace, INVERSE>=1);
                 assert(other==id);
                 std::reverse(bfs_trace.begin(), bfs_trace.end());
                 perm pi; id_perm(pi);
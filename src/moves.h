@@ -0,0 +1,114 @@
+/*
+ * Jaco van de Pol, Aarhus University, 2025
+ *
+ * The moves of a frontier matrix, up to its automorphisms (PRUNE=1, without SWAP).
+ *
+ * If sigma . x = x, then the moves (i,j) and (sigma(i),sigma(j)) of x lead to
+ * equivalent successors, so only the smallest move of every orbit of Aut(x) on the
+ * moves has to be canonicalized and probed. An automorphism preserves the degrees
+ * of every index, so for most matrices, whose indices all differ, Aut(x) is
+ * trivial and this is decided with O(N^2) comparisons.
+ * The inessential indices I (no 1 off the diagonal in their row and column) can be
+ * permuted freely, and the smallest move picks the smallest indices of I. Of the
+ * other automorphisms (acting on the essential indices) only those within cells of
+ * at most PRUNE_PERMS permutations are enumerated; a subgroup of Aut(x) gives finer
+ * orbits, so this may keep more moves, but never loses a successor.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include "matrix.h"
+
+// essential automorphisms are only enumerated in cells with at most this many permutations
+const uint64_t PRUNE_PERMS = 120;
+
+// the next permutation of a[0..n-1] in lexicographic order, or false after the last
+// (std::next_permutation on a part of a perm gives a false -Wstringop-overflow in GCC 12)
+inline bool next_perm(byte a[], byte n) {
+    int i = n - 2;
+    while (i >= 0 && a[i] >= a[i+1]) i--;
+    if (i >= 0) {
+        int j = n - 1;
+        while (a[j] <= a[i]) j--;
+        byte t = a[i]; a[i] = a[j]; a[j] = t;
+    }
+    for (int l=i+1, r=n-1; l<r; l++, r--) {
+        byte t = a[l]; a[l] = a[r]; a[r] = t;
+    }
+    return i >= 0;
+}
+
+// the moves of x that are the smallest in their orbit under (a subgroup of) Aut(x)
+inline uint64_t move_orbits(matrix x) {
+    const matrix ROW = (1ULL << N) - 1;
+    uint16_t key[N] = {}; // the diagonal, and the ones in the row and column of every index
+    for (byte i=0; i<N; i++) {
+        matrix row = (x >> N*i) & ROW & ~(1ULL << i);
+        key[i] |= !((x >> (N+1)*i) & 1) << 8 | __builtin_popcountll(row) << 4;
+        for (; row; row &= row - 1) key[__builtin_ctzll(row)]++;
+    }
+    bool distinct = true;
+    for (byte i=0; i<N; i++)
+        for (byte j=i+1; j<N; j++)
+            distinct &= key[i] != key[j];
+    if (distinct) return ALL_MOVES;
+
+    // the indices ordered by key (and index); the cells of equal keys, and the inessential indices
+    perm order; id_perm(order);
+    std::sort(order, order+N, [&](byte a, byte b) { return key[a] < key[b] || (key[a] == key[b] && a < b); });
+    byte inessential[N], ness = 0; // the inessential indices, increasing
+    bool isInessential[N];
+    for (byte i=0; i<N; i++) {
+        isInessential[i] = key[i] == 0;
+        if (key[i] == 0) inessential[ness++] = i;
+    }
+
+    // the automorphisms on the essential indices, by enumerating their cells
+    byte start = ness; // order[0..ness-1] are inessential (key 0 is the smallest)
+    byte cycles[N+1], c = 0;
+    uint64_t perms = 1;
+    for (byte i=start; i<N; ) {
+        byte j = i+1;
+        while (j<N && key[order[j]] == key[order[i]]) j++;
+        cycles[c++] = j-i;
+        perms *= fac[j-i];
+        i = j;
+    }
+    cycles[c] = 0;
+    byte auts[PRUNE_PERMS][N]; // the automorphisms found, starting with the identity
+    size_t naut = 1;
+    id_perm(auts[0]);
+    if (perms > 1 && perms <= PRUNE_PERMS) {
+        perm list; // a permutation of order[start..], within the cells
+        for (byte i=0; i<N; i++) list[i] = order[i];
+        for (;;) {
+            byte k = start; // next permutation of list within the cells (as next_cycle_perm)
+            byte cc = 0;
+            while (cycles[cc] && !next_perm(list + k, cycles[cc]))
+                k += cycles[cc++];
+            if (!cycles[cc]) break;
+            byte* sigma = auts[naut]; // order[p] -> list[p]
+            for (byte p=0; p<N; p++) sigma[order[p]] = list[p];
+            if (permute(x, sigma) == x) naut++;
+        }
+    }
+    if (naut == 1 && ness < 2) return ALL_MOVES;
+
+    // keep a move iff it is the smallest of its orbit
+    uint64_t moves = 0;
+    for (byte i=0; i<N; i++)
+        for (byte j=0; j<N; j++) {
+            if (i == j) continue;
+            bool smallest = true;
+            for (size_t s=0; s<naut; s++) {
+                byte a = auts[s][i], b = auts[s][j];
+                if (isInessential[a] && isInessential[b]) { a = inessential[0]; b = inessential[1]; }
+                else if (isInessential[a]) a = inessential[0];
+                else if (isInessential[b]) b = inessential[0];
+                if (a < i || (a == i && b < j)) { smallest = false; break; }
+            }
+            if (smallest) moves |= 1ULL << move_index(i, j);
+        }
+    return moves;
+}
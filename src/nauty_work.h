@@ -0,0 +1,63 @@
+/*
+ * Jaco van de Pol, Aarhus University, 2025
+ *
+ * NautyWork: a per-thread workspace for calling nauty on a matrix graph.
+ *
+ * densenauty() starts every call from a single cell of all vertices, and checks
+ * and adapts the options block. Instead, every thread keeps its graphs, labels
+ * and nauty's workspace in one place, and calls nauty() directly, starting from
+ * cells of vertices with the same key (the diagonal bit and degrees, computed in
+ * O(N) with popcounts). The keys are invariant under the permutations of the
+ * matrix, so the canonical form is still the same for all matrices in an orbit,
+ * while nauty starts from refined cells. One call provides the canonical graph
+ * and the canonical labeling, so trace-back does not need a second call.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include "nauty.h"
+#include "matrix.h"
+
+template<int M, int V> // setwords per vertex, vertices
+struct NautyWork {
+    static constexpr int WORKSPACE = 2*500*M; // as in densenauty
+
+    graph g[M*V];
+    graph h[M*V];
+    int lab[V], ptn[V], orbits[V];
+    statsblk stats;
+    set workspace[WORKSPACE];
+
+    // the workspace of this thread
+    static NautyWork& get() {
+        static thread_local NautyWork work;
+        return work;
+    }
+
+    // the initial partition: vertices with equal keys form a cell, ordered by key
+    void color(const uint32_t key[V]) {
+        for (int v=0; v<V; v++) lab[v] = v;
+        std::sort(lab, lab+V, [&](int a, int b) { return key[a] < key[b]; });
+        for (int v=0; v<V; v++)
+            ptn[v] = v+1 < V && key[lab[v]] == key[lab[v+1]];
+    }
+
+    // the canonical labeling in lab and graph in h of the colored graph g
+    void canonize(optionblk* options) {
+        nauty(g,lab,ptn,NULL,orbits,options,&stats,workspace,WORKSPACE,M,V,h);
+    }
+};
+
+// the number of ones in every row i and column j of x (without the diagonal if offdiag)
+inline void degrees(matrix x, byte rows[N], byte cols[N], bool offdiag) {
+    const matrix ROW = (1ULL << N) - 1;
+    matrix col = 0; // the bits of column 0
+    for (byte i=0; i<N; i++) col |= 1ULL << N*i;
+    if (offdiag)
+        for (byte i=0; i<N; i++) x &= ~(1ULL << (N+1)*i);
+    for (byte i=0; i<N; i++) {
+        rows[i] = __builtin_popcountll((x >> N*i) & ROW);
+        cols[i] = __builtin_popcountll(x & (col << i));
+    }
+}
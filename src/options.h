@@ -20,17 +20,160 @@ const uint64_t fac[] = {1, 1, 2, 6, 24, 120, 720, 5040, 40320};
 #define MAX 34 // maximum allocated table, set with -DMAX=36
 #endif
 
+#ifndef GLOBAL
+#define GLOBAL 0 // a single table for all levels, with depth tags, enable with -DGLOBAL=1
+#endif
+
+#if GLOBAL==1
+#if N>7
+#error "GLOBAL requires N<=7: depth tags are stored in the bits above N*N"
+#endif
+#undef GROW
+#define GROW 1 // the single table must grow
+#endif
+
+#ifndef GROW
+#define GROW 1 // grow hash tables online (E is then the load factor), disable with -DGROW=0
+#endif
+
+#ifndef COMPACT
+#define COMPACT 0 // compact hash tables storing only remainders of N*N bits, enable with -DCOMPACT=1
+#endif
+
+#ifndef SWISS
+#define SWISS 0 // hash tables with SIMD matching of 7-bit tags in groups, enable with -DSWISS=1
+#endif
+
+#if SWISS==1 && COMPACT==1
+#error "SWISS cannot be combined with COMPACT"
+#endif
+
+#ifndef FREEZE
+#define FREEZE 0 // freeze completed levels into succinct sorted sets, enable with -DFREEZE=1
+#endif
+
+#ifndef ORDERED
+#define ORDERED 0 // sort clusters of completed levels, for early termination of lookups, enable with -DORDERED=1
+#endif
+
+#if ORDERED==1 && (COMPACT==1 || SWISS==1 || FREEZE==1 || GLOBAL==1)
+#error "ORDERED cannot be combined with COMPACT, SWISS, FREEZE or GLOBAL"
+#endif
+
+#if GLOBAL==1 && (COMPACT==1 || SWISS==1 || FREEZE==1)
+#error "GLOBAL cannot be combined with COMPACT, SWISS or FREEZE"
+#endif
+
+#ifndef FILTER
+#define FILTER 0 // bits per key of a Bloom filter for completed levels (0 is no filter), set with -DFILTER=8
+#endif
+
+#if FILTER>0 && GLOBAL==1
+#error "FILTER cannot be combined with GLOBAL"
+#endif
+
+#ifndef ARENA
+#define ARENA 0 // recycle table memory across levels, with huge pages and parallel pre-faulting, enable with -DARENA=1
+#endif
+
+#ifndef SHARDS
+#define SHARDS 1 // split level tables into SHARDS (a power of 2) separate tables, set with -DSHARDS=8
+#endif
+
+#if SHARDS & (SHARDS-1)
+#error "SHARDS should be a power of 2"
+#endif
+
+#ifndef NUMA
+#define NUMA 0 // NUMA placement: 0 first touch, 1 shards on nodes, 2 interleave all tables, set with -DNUMA=1
+#endif
+
+#if SHARDS>1 && GLOBAL==1
+#error "SHARDS cannot be combined with GLOBAL"
+#endif
+
+#if NUMA==1 && SHARDS==1
+#error "NUMA=1 places shards on nodes, so it requires SHARDS>1"
+#endif
+
+#ifndef CACHE
+#define CACHE 0 // per-thread cache of 2^CACHE canonical forms (0 is no cache), set with -DCACHE=16
+#endif
+
+#ifndef KERNEL
+#define KERNEL 1 // bit-matrix kernels for permutations and finger-prints, selected at run time, disable with -DKERNEL=0
+#endif
+
+#ifndef SIMD
+#define SIMD 1 // normalize the successors of a matrix together, in SIMD lanes (permutations only), disable with -DSIMD=0
+#endif
+
+#ifndef BATCH
+#define BATCH 16 // frontier elements expanded together, with prefetching; 0 to disable
+#endif
+
 #ifndef SWAP
-#define SWAP 0 // SWAPS for free, enable with -DSWAP=1
+#define SWAP 0 // SWAPS for free (with NAUTY=1 on a graph for nauty), enable with -DSWAP=1
 #endif
 
 #if SWAP==1
-#define NAUTY 1  // SWAP requires Nauty
 #define POLY 0  // SWAP is incompatible with POLY
 #endif
 
 #ifndef NAUTY
-#define NAUTY 0 // using Nauty instead of permutations, disable with -DNAUTY=0
+#define NAUTY 0 // using Nauty instead of permutations, or 2 for Nauty only on large finger-print cells, set with -DNAUTY=1
+#endif
+
+#if SWAP==1 && NAUTY==2
+#error "SWAP cannot be combined with NAUTY=2"
+#endif
+
+#ifndef LOOKUP
+#define LOOKUP 0 // table of the canonical forms of all matrices (N<=5, no SWAP): 1 built at startup, 2 also kept in a file, set with -DLOOKUP=1
+#endif
+
+#if LOOKUP>=1 && (N>5 || SWAP==1)
+#error "LOOKUP requires N<=5 and SWAP=0: the table has 2^(N*N) entries with one permutation"
+#endif
+
+#ifndef PRUNE
+#define PRUNE 1 // expand only one move per orbit of the automorphisms of a matrix (not with SWAP), disable with -DPRUNE=0
+#endif
+
+#ifndef INVERSE
+#define INVERSE 0 // quotient the forward search also by inverse transpose (1), or by inverse and transpose (2) (not with SWAP), set with -DINVERSE=1
+#endif
+
+#if INVERSE>=1 && SWAP==1
+#error "INVERSE cannot be combined with SWAP"
+#endif
+
+#ifndef ORDERLY
+#define ORDERLY 0 // a matrix is only generated by its canonical parent (its first row operation into the current level), so next levels need no deduplication, enable with -DORDERLY=1
+#endif
+
+#ifndef BACK
+#define BACK 0 // skip the moves back into the previous level, marked in the bits above N*N of the level tables, enable with -DBACK=1
+#endif
+
+#if BACK==1 && N>7
+#error "BACK requires N<=7: the back moves are stored in the bits above N*N"
+#endif
+
+#if BACK==1 && (SWAP==1 || NAUTY==1 || SIMD==0 || LOOKUP>=1 || INVERSE>=1 || ORDERLY==1)
+#error "BACK requires the SuccessorBatch (SIMD=1, without SWAP, NAUTY=1 or LOOKUP), and no INVERSE or ORDERLY"
+#endif
+
+#if BACK==1 && (GLOBAL==1 || COMPACT==1 || SWISS==1 || FREEZE==1 || ORDERED==1 || FILTER>0)
+#error "BACK requires level tables that keep their buckets: no GLOBAL, COMPACT, SWISS, FREEZE, ORDERED or FILTER"
+#endif
+
+#ifndef DENSE
+#define DENSE 0 // BFS over all of GL(N,2) (N<=6, without goal), with 2 bits per ranked matrix, enable with -DDENSE=1
+#endif
+
+#if DENSE==1 && (N>6 || SWAP==1 || POLY==1)
+#error "DENSE requires N<=6, without SWAP or POLY: it visits all 2*10^10 matrices of N=6 without symmetries"
 #endif
 
 #ifndef POLY
@@ -1,20 +1,284 @@
 #ifndef REPRwrap_H
 #define REPRwrap_H
 
-#if SWAP==1
+#if SWAP==1 && NAUTY==1
 #include "repr_nauty_swap.h"
+#elif SWAP==1
+#include "repr_swap.h"
 #elif NAUTY==1
 #include "repr_nauty.h"
 #else
 #include "repr_perm.h"
 #endif
 
+#include "cache.h"
+#if LOOKUP>=1
+#include "lookup.h"
+#endif
+#if SWAP==0 && NAUTY!=1 && SIMD==1 && LOOKUP==0
+#include "repr_batch.h"
+#endif
+#if SWAP==0 && PRUNE==1
+#include "moves.h"
+#endif
+
+// set y to its canonical form and return its number of automorphisms, from the table
+// or the cache if possible
+// (the division into the orbit size, orbit_size(aut), is left to the matrices that are new)
+inline uint64_t canonical_aut(matrix &y) {
+#if LOOKUP>=1
+    return canonTable.lookup(y);
+#elif CACHE>0
+    return canonCache.lookup(y, [](matrix &x) { return automorphisms(x); });
+#else
+    return automorphisms(y);
+#endif
+}
+
+// set y to its canonical form and return its orbit size
+inline uint64_t canonical(matrix &y) {
+    return orbit_size(canonical_aut(y));
+}
+
+// What the successors of a frontier matrix x share: with permutations, its finger-print,
+// from which the finger-print of each successor is derived in O(N), and the moves
+// that are needed, one per orbit of Aut(x) if PRUNE=1
+struct Parent {
+    matrix x;
+    uint64_t moves;
+#if SWAP==0 && NAUTY!=1 && LOOKUP==0
+    finger_t finger[N];
+#endif
+#if SWAP==0 && PRUNE==1
+    Parent(matrix x): Parent(x, move_orbits(x)) {}
+#else
+    Parent(matrix x): Parent(x, ALL_MOVES) {}
+#endif
+    Parent(matrix x, uint64_t moves): x(x), moves(moves) {
+#if SWAP==0 && NAUTY!=1 && LOOKUP==0
+        fingerprint(x, finger);
+#endif
+    }
+};
+
+// set y to the canonical form of the successor of p.x that adds row i to row j,
+// and return its number of automorphisms
+inline uint64_t canonical_successor(const Parent &p, byte i, byte j, matrix &y) {
+    y = successor(p.x, i, j);
+#if SWAP==0 && NAUTY!=1 && LOOKUP==0
+    auto canon = [&](matrix &z) {
+        finger_t finger[N];
+        successor_fingerprint(p.x, p.finger, i, j, finger);
+        return automorphisms(z, finger);
+    };
+#if CACHE>0
+    return canonCache.lookup(y, canon);
+#else
+    return canon(y);
+#endif
+#else
+    return canonical_aut(y);
+#endif
+}
+
+// set succ to the canonical forms of the successors of p.x by the moves in p.moves, in
+// the order of the moves (i,j) with i != j, and aut to their numbers of automorphisms;
+// with BACK=1, back (if given) gets the bit of the move of each successor back to p.x;
+// return the number of successors (at most MOVES)
+inline size_t canonical_successors(const Parent &p, matrix succ[], uint64_t aut[], uint64_t back[]=nullptr) {
+    size_t k = 0;
+#if SWAP==0 && NAUTY!=1 && SIMD==1 && LOOKUP==0
+    SuccessorBatch batch(p.x, p.finger);
+    for (uint64_t moves=p.moves; moves; moves &= moves - 1, k++) {
+        size_t m = __builtin_ctzll(moves);
+        succ[k] = batch.successor(m);
+#if BACK==1 // the cache keeps the labelling of y, from which the move back to p.x follows
+        auto canon = [&](matrix &z) { return batch.labelled_automorphisms(m, z); };
+#else
+        auto canon = [&](matrix &z) { return batch.automorphisms(m, z); };
+#endif
+#if CACHE>0
+        aut[k] = canonCache.lookup(succ[k], canon);
+#else
+        aut[k] = canon(succ[k]);
+#endif
+#if BACK==1
+        if (back) back[k] = SuccessorBatch::back_move(m, aut[k]);
+        aut[k] &= (1ULL << SuccessorBatch::LABEL) - 1;
+#endif
+    }
+#else
+    size_t m = 0;
+    for (byte i=0; i<N; i++)
+        for (byte j=0; j<N; j++) // add to row j
+            if (i != j && ((p.moves >> m++) & 1)) {
+                aut[k] = canonical_successor(p, i, j, succ[k]);
+                k++;
+            }
+#endif
+    return k;
+}
+
+// the canonical form of the first successor of p.x, in the order of the moves, for which
+// found(y, aut) holds (found may change y), or 0 if there is none; the successors after
+// it are not canonicalized
+template<typename FOUND>
+inline matrix first_successor(const Parent &p, FOUND found) {
+#if SWAP==0 && NAUTY!=1 && SIMD==1 && LOOKUP==0
+    SuccessorBatch batch(p.x, p.finger);
+    for (uint64_t moves=p.moves; moves; moves &= moves - 1) {
+        size_t m = __builtin_ctzll(moves);
+        matrix y = batch.successor(m);
+        auto canon = [&](matrix &z) { return batch.automorphisms(m, z); };
+#if CACHE>0
+        uint64_t aut = canonCache.lookup(y, canon);
+#else
+        uint64_t aut = canon(y);
+#endif
+        if (found(y, aut)) return y;
+    }
+#else
+    size_t m = 0;
+    for (byte i=0; i<N; i++)
+        for (byte j=0; j<N; j++)
+            if (i != j && ((p.moves >> m++) & 1)) {
+                matrix y;
+                uint64_t aut = canonical_successor(p, i, j, y);
+                if (found(y, aut)) return y;
+            }
+#endif
+    return 0;
+}
+
+// the successors expanded per matrix: also the column operations with INVERSE=2
+const size_t SUCCESSORS = INVERSE==2 ? 2*MOVES : MOVES;
+
+#if INVERSE>=1
+// The distance of x is also the distance of x^-1 (reverse the circuit) and of x^T (also
+// swap controls and targets), and these commute with the permutations. The forward search
+// is quotiented by the group of x and x^-T (INVERSE=1), or of x, x^-T, x^T and x^-1
+// (INVERSE=2), times the permutations: the canonical form of x is the smallest canonical
+// form of these variants.
+// Only x^-T maps the successors of x to the successors of x^-T, by the reversed moves, so
+// with INVERSE=1 the canonical forms of both come from a SuccessorBatch, and the row
+// operations suffice. With INVERSE=2, the orbit of x also holds the column operations,
+// which are the row operations of x^T, and x^T and x^-1 are canonicalized one by one.
+const byte DUALS = INVERSE==1 ? 2 : 4;
+
+// the variant v of x: bit 0 for the inverse, bit 1 for the transpose
+inline matrix dual(matrix x, byte v) {
+    if (v & 1) x = inverse(x);
+    if (v & 2) x = transpose(x);
+    return x;
+}
+
+// canon[0] and canon[1] are the canonical forms of y and y^-T: add those of y^T and y^-1
+inline void dual_transposes(matrix canon[DUALS]) {
+#if INVERSE==2
+    canon[2] = transpose(canon[0]);
+    canonical_aut(canon[2]);
+    canon[3] = transpose(canon[1]);
+    canonical_aut(canon[3]);
+#endif
+}
+
+// set y to the smallest of the canonical forms of its variants, where canon[0] is y with
+// aut automorphisms, and return its number of automorphisms in the larger group
+inline uint64_t dual_combine(matrix &y, const matrix canon[DUALS], uint64_t aut) {
+    byte distinct = 1; // the variants form 1, 2 or 4 orbits of permutations
+    for (byte v=1; v<DUALS; v++) {
+        bool seen = false;
+        for (byte w=0; w<v; w++) seen |= canon[w] == canon[v];
+        distinct += !seen;
+        y = std::min(y, canon[v]);
+    }
+    return DUALS * aut / distinct;
+}
+
+// y is canonical with aut automorphisms: set y to its canonical form in the larger
+// group, and return its number of automorphisms there
+inline uint64_t dual_aut(matrix &y, uint64_t aut) {
+    matrix canon[DUALS] = {y, dual(y, 3)};
+    canonical_aut(canon[1]);
+    dual_transposes(canon);
+    return dual_combine(y, canon, aut);
+}
+
+inline uint64_t dual_orbit_size(uint64_t aut) { return DUALS * fac[N] / aut; }
+
+// set y to its canonical form in the larger group and return its orbit size
+inline uint64_t dual_canonical(matrix &y) {
+    return dual_orbit_size(dual_aut(y, canonical_aut(y)));
+}
+
+// set succ to the canonical forms in the larger group of the row operations of x, and aut
+// to their numbers of automorphisms; return their number
+inline size_t dual_row_successors(matrix x, matrix succ[], uint64_t aut[]) {
+    Parent p(x);
+    uint64_t reversed = 0; // (E_ij x)^-T = E_ji x^-T
+    for (uint64_t moves=p.moves; moves; moves &= moves - 1)
+        reversed |= 1ULL << reverse_move(__builtin_ctzll(moves));
+    matrix inv[MOVES];
+    uint64_t invAut[MOVES];
+    size_t size = canonical_successors(p, succ, aut);
+    canonical_successors(Parent(dual(x, 3), reversed), inv, invAut);
+    size_t k = 0;
+    for (uint64_t moves=p.moves; moves; moves &= moves - 1, k++) {
+        uint64_t before = (1ULL << reverse_move(__builtin_ctzll(moves))) - 1;
+        matrix canon[DUALS] = {succ[k], inv[__builtin_popcountll(reversed & before)]};
+        dual_transposes(canon);
+        aut[k] = dual_combine(succ[k], canon, aut[k]);
+    }
+    return size;
+}
+
+// set succ to the canonical forms in the larger group of the successors of x, and aut to
+// their numbers of automorphisms; return their number
+inline size_t dual_successors(matrix x, matrix succ[], uint64_t aut[]) {
+    size_t k = dual_row_successors(x, succ, aut);
+#if INVERSE==2
+    k += dual_row_successors(transpose(x), succ + k, aut + k); // x^T is in the orbit of x
+#endif
+    return k;
+}
+#endif
+
+#if LOOKUP>=1
+// fill the table with the canonical forms of this representation; with LOOKUP=2 from
+// (or into) a file, named after NAUTY since the canonical forms depend on it.
+// Return how the table was filled
+inline const char* init_table() {
+    auto canon = [](matrix &y, perm pi) {
+        representativePerm(y, pi);
+        return automorphisms(y);
+    };
+#if LOOKUP==2
+    std::string file = "canon" + std::to_string(N) + "-nauty" + std::to_string(NAUTY) + ".tbl";
+    if (canonTable.load(file, canon)) return "loaded";
+#endif
+    canonTable.build(canon);
+#if LOOKUP==2
+    canonTable.save(file);
+#endif
+    return "built";
+}
+#endif
+
 #if SWAP==0
+// set pi to the permutation from x to its canonical form, from the table if possible
+inline void canonical_perm(matrix x, perm pi) {
+#if LOOKUP>=1
+    canonTable.permutation(x, pi);
+#else
+    representativePerm(x, pi);
+#endif
+}
+
 // assuming m1 and m2 are equivalent, find pi such that pi . m1 = m2
 void equiv_perm(matrix m1, matrix m2, perm pi) {
     perm pi1, pi2;
-    representativePerm(m1, pi1);    // repr = pi1 . m1
-    representativePerm(m2, pi2);    // repr = pi2 . m2
+    canonical_perm(m1, pi1);    // repr = pi1 . m1
+    canonical_perm(m2, pi2);    // repr = pi2 . m2
     compose_inv_perm(pi2, pi1, pi);
     assert(permute(m1, pi1) == permute(m2, pi2)); // both are repr
     assert(permute(m1, pi) == m2);  // pi . m1 = m2
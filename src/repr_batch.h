@@ -0,0 +1,195 @@
+/*
+ * Jaco van de Pol, Aarhus University, 2025
+ *
+ * SuccessorBatch: normalize all N(N-1) successors of a frontier matrix at once,
+ * with one successor per SIMD lane (SIMD=1, with permutations only).
+ *
+ * Sorting the finger-prints one successor at a time (std::sort on byte arrays)
+ * costs more than the rest of the canonicalization, because of its unpredictable
+ * branches. Here the finger-print of index k of all successors is one vector of
+ * 16-bit keys (not diagonal, row sum, column sum, k), so that a sorting network
+ * of min/max instructions on the N vectors sorts the finger-prints of all lanes
+ * together, without branches. The keys are distinct, so the sorted keys give the
+ * same permutation and cells as sort_finger and finger_cycles.
+ *
+ * The successor that adds row i to row j only changes row j, so its keys are the
+ * keys of the parent, updated with the rows i and j of the parent (one shuffle of
+ * the parent rows per lane). The lane of a successor is fixed: its move (i,j) is
+ * in a constant vector. The vectors are GCC vector extensions of 16-bit lanes,
+ * so the compiler uses the widest registers of the target (see ARCH): 32 lanes
+ * with AVX-512, 16 with AVX2, 8 with SSE2.
+ * The orbit search on the normalized successors is scalar, per lane.
+ */
+
+#pragma once
+
+#include <cstring>
+#include "matrix.h"
+#include "repr_perm.h"
+
+namespace batch {
+
+#if defined(__AVX512BW__)
+const size_t LANES = 32; // 16-bit lanes in a vector register
+#elif defined(__AVX2__)
+const size_t LANES = 16;
+#else
+const size_t LANES = 8;
+#endif
+const size_t GROUPS = (MOVES + LANES - 1) / LANES; // vectors of successors
+
+// the move (i,j) of every lane; the lanes after the last move repeat (0,1)
+struct Moves {
+    uint16_t i[GROUPS*LANES], j[GROUPS*LANES], jbit[GROUPS*LANES];
+    uint64_t shift[GROUPS*LANES];
+    constexpr Moves(): i(), j(), jbit(), shift() {
+        size_t m = 0;
+        for (byte a=0; a<N; a++)
+            for (byte b=0; b<N; b++)
+                if (a != b) { i[m] = a; j[m] = b; m++; }
+        for (; m<GROUPS*LANES; m++) { i[m] = 0; j[m] = 1; }
+        for (m=0; m<GROUPS*LANES; m++) {
+            jbit[m] = 1U << j[m];
+            shift[m] = N*j[m];
+        }
+    }
+};
+inline constexpr Moves moves{};
+
+} // namespace batch
+
+class SuccessorBatch {
+public:
+    static constexpr size_t LANES = batch::LANES;
+    static constexpr size_t GROUPS = batch::GROUPS;
+
+    typedef uint16_t lanes16 __attribute__((vector_size(2*LANES)));
+    typedef uint64_t lanes64 __attribute__((vector_size(8*LANES)));
+
+    // the successors of x, whose (unsorted) finger-print is finger, in the order
+    // of the moves (i,j) with i != j, as in canonical_successors
+    SuccessorBatch(matrix x, const finger_t finger[N]) {
+        uint16_t rows[LANES] = {}, keys[N];
+        for (byte k=0; k<N; k++) {
+            rows[k] = (x >> N*k) & ROW;
+            keys[k] = finger[k][0] << 12 | finger[k][1] << 8 | finger[k][2] << 4 | k;
+        }
+        lanes16 R;
+        load(R, rows);
+        for (size_t g=0; g<GROUPS; g++)
+            normalize(g, x, R, keys);
+    }
+
+    matrix successor(size_t m) const { return _succ[m]; }
+
+    // y is successor m: set y to its canonical form and return its number of automorphisms
+    uint64_t automorphisms(size_t m, matrix &y) const {
+        return canonize(m, y, nullptr);
+    }
+
+    // as automorphisms, with above bit LABEL the index in the canonical y of every index
+    // of the successor (4 bits each), which only depends on y, so a cache can keep it
+    static constexpr size_t LABEL = 32;
+    uint64_t labelled_automorphisms(size_t m, matrix &y) const {
+        perm pi, pi2;
+        uint64_t aut = canonize(m, y, pi2);
+        for (byte t=0; t<N; t++) pi[t] = _keys[t][m] & 0xF;
+        for (byte t=0; t<N; t++) aut |= uint64_t(t) << (LABEL + 4*pi[pi2[t]]);
+        return aut;
+    }
+
+    // the bit of the move of the canonical y (labelled by labelled_automorphisms) that leads
+    // back to (a permutation of) the parent: the move (i,j) of successor m, relabelled
+    static uint64_t back_move(size_t m, uint64_t labelled) {
+        auto label = [&](byte k) { return byte((labelled >> (LABEL + 4*k)) & 0xF); };
+        return 1ULL << move_index(label(batch::moves.i[m]), label(batch::moves.j[m]));
+    }
+
+private:
+    static constexpr uint16_t ROW = (1U << N) - 1;
+
+    // canonize successor m in y; set pi2 (if given) to the permutation after the sorted keys
+    uint64_t canonize(size_t m, matrix &y, byte *pi2) const {
+        perm pi;
+        for (byte t=0; t<N; t++) pi[t] = _keys[t][m] & 0xF;
+        byte essential = __builtin_popcount(_inessential[m]);
+        byte cycles[N+1];
+        byte c = 0;
+        uint32_t starts = (_starts[m] | 1U << N) & ~((2U << essential) - 1);
+        for (byte i=essential; i<N; starts &= starts - 1) {
+            byte j = __builtin_ctz(starts);
+            cycles[c++] = j - i;
+            i = j;
+        }
+        cycles[c] = 0;
+        y = permute(y, pi);
+        return orbit_automorphisms(y, cycles, essential, pi2);
+    }
+
+    template<typename V, typename T>
+    static void load(V &v, const T* p) { memcpy(&v, p, sizeof(v)); }
+
+    template<typename V, typename T>
+    static void store(T* p, const V &v) { memcpy(p, &v, sizeof(v)); }
+
+    // the number of ones in every lane (of at most 8 bits)
+    static lanes16 popcount(lanes16 v) {
+        v = v - ((v >> 1) & 0x55);
+        v = (v & 0x33) + ((v >> 2) & 0x33);
+        return (v + (v >> 4)) & 0x0F;
+    }
+
+    // the successors of lanes g*LANES .. (g+1)*LANES - 1, and their sorted keys
+    void normalize(size_t g, matrix x, lanes16 R, const uint16_t keys[N]) {
+        size_t base = g*LANES;
+        lanes16 I, J, jbit;
+        lanes64 shift;
+        load(I, batch::moves.i + base);
+        load(J, batch::moves.j + base);
+        load(jbit, batch::moves.jbit + base);
+        load(shift, batch::moves.shift + base);
+        lanes16 ri = __builtin_shuffle(R, I); // row i of x, added to row j
+        lanes16 rj = __builtin_shuffle(R, J); // row j of x
+        lanes16 row = ri ^ rj;                // row j of the successor
+        store(_succ + base, x ^ (__builtin_convertvector(ri, lanes64) << shift));
+
+        // row j gets a new diagonal and row sum; the columns where row i has a 1
+        // (off the diagonal of row j) get one more 1, or one less if row j had a 1
+        lanes16 diag0 = (lanes16)((row & jbit) == 0) & 1; // a comparison is -1 for true
+        lanes16 jkey = diag0 << 12 | popcount(row & ~jbit) << 8;
+        lanes16 key[N];
+        for (byte k=0; k<N; k++) {
+            lanes16 parent = lanes16{} + keys[k];
+            lanes16 bi = (ri >> k) & 1;
+            lanes16 bj = (rj >> k) & 1;
+            key[k] = J == k ? (jkey | (parent & 0xFF))
+                            : parent + (bi << 4) - ((bi & bj) << 5);
+        }
+
+        // odd-even transposition sort: N rounds of compare-exchange on neighbours
+        for (byte r=0; r<N; r++)
+            for (byte k=r%2; k+1<N; k+=2) {
+                lanes16 lo = key[k] < key[k+1] ? key[k] : key[k+1];
+                lanes16 hi = key[k] < key[k+1] ? key[k+1] : key[k];
+                key[k] = lo;
+                key[k+1] = hi;
+            }
+
+        // the inessential indices (finger-print 0) come first; a cell starts
+        // where the finger-print differs from the previous one
+        lanes16 inessential = lanes16{}, starts = lanes16{};
+        for (byte t=0; t<N; t++) {
+            uint16_t bit = 1U << t;
+            inessential |= (lanes16)((key[t] >> 4) == 0) & bit;
+            if (t > 0) starts |= (lanes16)((key[t] >> 4) != (key[t-1] >> 4)) & bit;
+            store(_keys[t] + base, key[t]);
+        }
+        store(_inessential + base, inessential);
+        store(_starts + base, starts);
+    }
+
+    matrix _succ[GROUPS*LANES];
+    uint16_t _keys[N][GROUPS*LANES];  // the sorted keys; the low 4 bits are the indices
+    uint16_t _inessential[GROUPS*LANES]; // bit t is set iff index t is inessential
+    uint16_t _starts[GROUPS*LANES];   // bit t is set iff a cell starts at index t
+};
@@ -0,0 +1,130 @@
+/*
+ * Jaco van de Pol, Aarhus University, 2025
+ *
+ * Hybrid canonicalization (NAUTY=2): permutation search or nauty, per matrix.
+ *
+ * The permutation search (repr_perm.h) is fast when the cells of indices with
+ * equal finger-prints are small, but its work grows with the product of their
+ * factorials, whereas nauty has a fixed cost per call that dominates for easy
+ * matrices. Both start from the matrix sorted by its finger-print, and the choice
+ * only depends on the sizes of its cells, which are the same for all matrices in
+ * an orbit. So every orbit is always canonicalized in the same way, and gets a
+ * single representative: the smallest matrix if its cells are small, and otherwise
+ * nauty's canonical form of the graph whose vertices are colored by their cells.
+ *
+ * The matrices and the time per method are counted per thread, and reported per
+ * level. The time of a search is so short that reading the time-stamp counter
+ * would be noticeable, so only a sample of the searches is timed.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <x86intrin.h>
+#include <omp.h>
+#include "nauty.h"
+#include "nautinv.h"
+#include "matrix.h"
+#include "nauty_work.h"
+
+const byte m=1; // nauty
+const byte n=N; //
+static DEFAULTOPTIONS_DIGRAPH(options); // with getcanon and without defaultptn, see main
+
+// cells with more permutations than this are canonicalized by nauty
+// (at N=8, nauty only catches up with OrbitSearch from about 7! permutations)
+const uint64_t NAUTY_PERMS = 1440;
+
+// Nauty uses the most-significant bits, and our row i is Nauty's row N-i-1
+inline void cells2nauty(const matrix &y, graph g[m*n]) {
+    EMPTYGRAPH(g,m,n);
+    for (byte i=0; i<N; i++)
+        g[N-i-1] = ((y >> N*i) & ((1<<N) - 1)) << (WORDSIZE-N);
+}
+
+inline matrix nauty2cells(const graph* g) {
+    matrix y=0LL;
+    for (byte i=0; i<N; i++)
+        y |= matrix(g[N-i-1] >> (WORDSIZE-N)) << (N*i);
+    return y;
+}
+
+// Assume y is normalized, with cycles and essential from compute_cycles.
+// Set y to nauty's canonical form of y, with the inessential indices and the
+// cycles as the colors, and pi to the permutation from (the old) y to it.
+// Return the number of automorphisms.
+inline uint64_t nauty_cells(matrix &y, const byte cycles[], byte essential, perm pi) {
+    NautyWork<m,n>& w = NautyWork<m,n>::get();
+    cells2nauty(y,w.g);
+    for (byte v=0; v<N; v++) {
+        w.lab[v] = v;
+        w.ptn[v] = 1;
+    }
+    w.ptn[N-1] = 0; // a cell starting at our index i ends at Nauty's vertex N-i-1
+    for (byte c=0, i=essential; cycles[c]; i += cycles[c++])
+        w.ptn[N-1-i] = 0;
+    w.canonize(&options);
+    for (byte i=0; i<N; i++)
+        pi[N-1-i] = N-1-w.lab[i];
+    assert(permute(y, pi) == nauty2cells(w.h));
+    y = nauty2cells(w.h);
+    return w.stats.grpsize;
+}
+
+// per-thread counts of the matrices canonicalized by each method, and their ticks
+class HybridStats {
+    struct alignas(64) Thread { // one per thread, to avoid false sharing
+        uint64_t count[2] = {0, 0};
+        uint64_t ticks[2] = {0, 0};
+    };
+
+public:
+    enum Method { SEARCH = 0, NAUTY_CELLS = 1 };
+    static constexpr uint64_t SAMPLE[2] = {16, 1}; // time one in SAMPLE matrices
+
+    HybridStats(): _threads(omp_get_max_threads()) { calibrate(); }
+
+    // counts a matrix, and measures the time until it goes out of scope: for
+    // the (many and short) searches only every SAMPLE-th time, to keep it cheap
+    class Timer {
+    public:
+        Timer(HybridStats& stats, Method method):
+            _thread(stats._threads[omp_get_thread_num()]), _method(method),
+            _start(_thread.count[method]++ % SAMPLE[method] == 0 ? __rdtsc() : 0) {}
+        ~Timer() { if (_start) _thread.ticks[_method] += (__rdtsc() - _start) * SAMPLE[_method]; }
+    private:
+        Thread& _thread;
+        Method _method;
+        uint64_t _start;
+    };
+
+    // the number of matrices and (estimated) seconds for a method since the previous call (only when quiescent)
+    std::pair<uint64_t,double> take(Method method) {
+        uint64_t count = 0, ticks = 0;
+        for (Thread& t : _threads) {
+            count += t.count[method];
+            ticks += t.ticks[method];
+            t.count[method] = t.ticks[method] = 0;
+        }
+        return std::make_pair(count, ticks / ticksPerSecond());
+    }
+
+private:
+    void calibrate() {
+        _startTicks = __rdtsc();
+        _start = std::chrono::steady_clock::now();
+    }
+
+    // the rate of the time-stamp counter, measured since the start
+    double ticksPerSecond() const {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+        return seconds > 0 ? (__rdtsc() - _startTicks) / seconds : 1e9;
+    }
+
+    std::vector<Thread> _threads;
+    uint64_t _startTicks;
+    std::chrono::steady_clock::time_point _start;
+};
+
+inline HybridStats hybridStats; // shared by all levels
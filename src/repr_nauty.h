@@ -5,10 +5,11 @@
 #include "nauty.h"
 #include "nautinv.h"
 #include "matrix.h"
+#include "nauty_work.h"
 
 const byte m=1; // nauty
 const byte n=N; // 
-static DEFAULTOPTIONS_DIGRAPH(options);
+static DEFAULTOPTIONS_DIGRAPH(options); // with getcanon and without defaultptn, see main
 
 void matrix2nauty(const matrix &y, graph g[m*n]) { // now always the same g
     EMPTYGRAPH(g,m,n);
@@ -35,30 +36,42 @@ matrix nauty2matrix(const graph* g) {
     return y;
 }
 
+using Work = NautyWork<m,n>;
+
+// set y to its canonical form, and pi to the permutation from y to it (in one nauty call)
+// return the number of automorphisms of y
+inline uint64_t canonize(matrix &y, perm pi) {
+    Work& w = Work::get();
+    byte rows[N], cols[N];
+    uint32_t key[n];
+    degrees(y, rows, cols, true);
+    for (byte i=0; i<N; i++) // our index i is Nauty's vertex N-i-1
+        key[N-i-1] = !((y >> (N+1)*i) & 1) << 8 | rows[i] << 4 | cols[i];
+    matrix2nauty(y,w.g);
+    w.color(key);
+    w.canonize(&options);
+    for (byte i=0; i<N; i++)
+        pi[N-1-i] = N-1-w.lab[i];       // revert N-1..0 to 0..N-100
+    assert(permute(y, pi) == nauty2matrix(w.h));
+    y=nauty2matrix(w.h); // this value is returned
+    return w.stats.grpsize;
+}
+
+// the size of the orbit of a matrix with aut automorphisms
+inline uint64_t orbit_size(uint64_t aut) { return fac[N] / aut; }
+
+inline uint64_t automorphisms(matrix &y) {
+    perm pi;
+    return canonize(y, pi);
+}
+
 inline uint64_t representative(matrix &y) {
-    graph g[m*n];
-    graph h[m*n];
-    int lab[n], ptn[n], orbits[n];
-    statsblk stats;
-    matrix2nauty(y,g);
-    densenauty(g,lab,ptn,orbits,&options,&stats,m,n,h);
-    uint64_t mysize = stats.grpsize;
-    // if (stats.grpsize2) {printf("Large group!\n"); exit(-1); }
-    y=nauty2matrix(h); // this value is returned
-    return fac[N] / mysize;
+    return orbit_size(automorphisms(y));
 }
 
 // return the permutation from x to its representative
 void representativePerm(matrix x, perm pi) {
-    graph g[m*n];
-    graph h[m*n];
-    int lab[n], ptn[n], orbits[n];
-    statsblk stats;
-    matrix2nauty(x,g);
-    densenauty(g,lab,ptn,orbits,&options,&stats,m,n,h);
-    for (byte i=0; i<N; i++)
-        pi[N-1-i] = N-1-lab[i];       // revert N-1..0 to 0..N-100
-    assert(permute(x, pi) == nauty2matrix(h));
+    canonize(x, pi);
 }
 
 void investigate(matrix x) {
@@ -4,10 +4,11 @@
 #include "nauty.h"
 #include "nautinv.h"
 #include "matrix.h"
+#include "nauty_work.h"
 
 const byte m=1; // nauty
 const byte n=2*N; // 
-static DEFAULTOPTIONS_DIGRAPH(options);
+static DEFAULTOPTIONS_DIGRAPH(options); // with getcanon and without defaultptn, see main
 
 void matrix2nauty(const matrix &y, graph g[m*n]) { // now always the same g
     EMPTYGRAPH(g,m,n);
@@ -48,32 +49,47 @@ matrix nauty2matrix(const graph* g) {
     return y;
 }
 
+using Work = NautyWork<m,n>;
+
+// set y to its canonical form, and pi1, pi2 to the permutations of its rows and
+// columns to it (in one nauty call); return the number of automorphisms of y
+inline uint64_t canonize(matrix &y, perm pi1, perm pi2) {
+    Work& w = Work::get();
+    byte rows[N], cols[N];
+    uint32_t key[n];
+    degrees(y, rows, cols, false);
+    for (byte i=0; i<N; i++) { // columns first, so the canonical form is (0 0; M' 0)
+        key[N-i-1] = cols[i];         // column i is Nauty's vertex N-i-1
+        key[2*N-i-1] = 16 | rows[i];  // row i is Nauty's vertex 2N-i-1
+    }
+    matrix2nauty(y,w.g);
+    w.color(key);
+    w.canonize(&options);
+    for (byte i=0; i<N; i++) {
+        pi2[N-1-i] = N-1-w.lab[i];       // revert N-1..0 to 0..N-100
+        pi1[N-1-i] = 2*N-1-w.lab[N+i]; // revert N-1..0 to 0..N-100
+    }
+    matrix z=nauty2matrix(w.h);
+    assert(permute2(y, pi1, pi2) == z);
+    y=z; // this value is returned
+    return w.stats.grpsize;
+}
+
+// the size of the orbit of a matrix with aut automorphisms
+inline uint64_t orbit_size(uint64_t aut) { return fac[N] * fac[N] / aut; }
+
+inline uint64_t automorphisms(matrix &y) {
+    perm pi1, pi2;
+    return canonize(y, pi1, pi2);
+}
+
 inline uint64_t representative(matrix &y) {
-    graph g[m*n];
-    graph h[m*n];
-    int lab[n], ptn[n], orbits[n];
-    statsblk stats;
-    matrix2nauty(y,g);
-    densenauty(g,lab,ptn,orbits,&options,&stats,m,n,h);
-    uint64_t mysize = stats.grpsize;
-    y=nauty2matrix(h); // this value is returned
-    return fac[N] * fac[N] / mysize;
+    return orbit_size(automorphisms(y));
 }
 
 // return the permutation from x to its representative
 void representativePerm2(matrix x, perm pi1, perm pi2) {
-    graph g[m*n];
-    graph h[m*n];
-    int lab[n], ptn[n], orbits[n];
-    statsblk stats;
-    matrix2nauty(x,g);
-    densenauty(g,lab,ptn,orbits,&options,&stats,m,n,h);
-    matrix y=nauty2matrix(h);
-    for (byte i=0; i<N; i++) {
-        pi2[N-1-i] = N-1-lab[i];       // revert N-1..0 to 0..N-100
-        pi1[N-1-i] = 2*N-1-lab[N+i]; // revert N-1..0 to 0..N-100
-    }
-    assert(permute2(x, pi1, pi2) == y);
+    canonize(x, pi1, pi2);
 }
 
 // assuming m1 and m2 are equivalent, find sig, tau such that (sig,tau) . m1 = m2
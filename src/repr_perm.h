@@ -3,6 +3,9 @@
 
 #include <algorithm>
 #include "matrix.h"
+#if NAUTY==2
+#include "repr_hybrid.h"
+#endif
 
 typedef std::array<byte,4> finger_t;
     // Fingerprint of an index i:
@@ -12,6 +15,18 @@ typedef std::array<byte,4> finger_t;
     // 3: store diagonal i  // this is only used locally to sort the matrix
 
 inline void fingerprint(matrix x, finger_t finger[N]) {
+#if KERNEL==1 // count all rows and columns at once, in the bytes of a stride-8 matrix
+    uint64_t x8 = bitmatrix::to_stride8(x);
+    uint64_t offdiag = x8 & ~bitmatrix::DIAG8;
+    uint64_t rows = bitmatrix::byte_counts(offdiag);
+    uint64_t cols = bitmatrix::byte_counts(bitmatrix::transpose8(offdiag));
+    for (byte i=0; i<N; i++) {
+        finger[i][0] = !((x8 >> 9*i) & 1);
+        finger[i][1] = (rows >> 8*i) & 0xFF;
+        finger[i][2] = (cols >> 8*i) & 0xFF;
+        finger[i][3] = i;
+    }
+#else
     for (byte i=0; i<N; i++) {
         finger[i][0] = 1;
         finger[i][1] = 0;
@@ -26,16 +41,42 @@ inline void fingerprint(matrix x, finger_t finger[N]) {
                 else {
                     finger[i][1]++; // count 1 on row i
                     finger[j][2]++; // count 1 on col j
-}           }   }
+                }
+            }
+#endif
+}
 
-// compute and sort the finger-print, return the normalized matrix and permutation
-inline matrix normalize(matrix x, finger_t finger[N], perm pi) {
-    fingerprint(x, finger);
+// Derive the finger-print of successor(x, i, j) from the finger-print of x:
+// only row j changes (row i is added to it), so only its diagonal and row sum,
+// and the column sums of the columns where row i has a 1, need an update
+inline void successor_fingerprint(matrix x, const finger_t parent[N], byte i, byte j, finger_t finger[N]) {
+    for (byte k=0; k<N; k++) finger[k] = parent[k];
+    matrix mask = (1ULL << N) - 1;
+    matrix row = (x >> N*i) & mask;   // row i, added to row j
+    matrix old = (x >> N*j) & mask;   // row j
+    matrix offdiag = row & ~(1ULL << j);
+    finger[j][0] = !(((old ^ row) >> j) & 1);
+    finger[j][1] = __builtin_popcountll((old ^ row) & ~(1ULL << j));
+    for (; offdiag; offdiag &= offdiag - 1) {
+        byte c = __builtin_ctzll(offdiag);
+        if ((old >> c) & 1) finger[c][2]--; // the 1 in [j][c] is cancelled
+        else finger[c][2]++;
+    }
+}
+
+// sort the finger-print of x, return the normalized matrix and permutation
+inline matrix sort_finger(matrix x, finger_t finger[N], perm pi) {
     std::sort(finger, finger+N);
     for (byte i=0; i<N; i++) pi[i] = finger[i][3];
     return permute(x,pi);
 }
 
+// compute and sort the finger-print, return the normalized matrix and permutation
+inline matrix normalize(matrix x, finger_t finger[N], perm pi) {
+    fingerprint(x, finger);
+    return sort_finger(x, finger, pi);
+}
+
 // generate next permutation of list[] as specified by cycles[]
 // cycles[] is 0-terminated, and sum(cycles) = len(list)
 inline bool next_cycle_perm(const byte cycles[], byte list[]) {
@@ -45,10 +86,10 @@ inline bool next_cycle_perm(const byte cycles[], byte list[]) {
 }
 
 // This function normalizes y, initializes cycles, and returns the first essential index
-inline byte compute_cycles(byte cycles[], matrix &y) {
-    finger_t finger[N]; // finger print
+// finger is the (unsorted) finger-print of y, which will be sorted
+inline byte finger_cycles(byte cycles[], matrix &y, finger_t finger[N]) {
     perm pi;
-    y = normalize(y, finger, pi); // this also initializes fingerprint and pi
+    y = sort_finger(y, finger, pi); // this also initializes pi
 
     // skip and count inessential indices
     byte i = 0;
@@ -72,11 +113,19 @@ inline byte compute_cycles(byte cycles[], matrix &y) {
     return essential;
 }
 
+// This function normalizes y, initializes cycles, and returns the first essential index
+inline byte compute_cycles(byte cycles[], matrix &y) {
+    finger_t finger[N]; // finger print
+    fingerprint(y, finger);
+    return finger_cycles(cycles, y, finger);
+}
+
 // Assume y is normalized
-// Update y to the smallest representative
+// Update y to the smallest representative (and set best to the permutation to it, if given)
 // Return the number of "essential" stabilizers
-inline uint64_t explore_orbit(matrix &y, byte cycles[], byte essential) {
+inline uint64_t explore_orbit(matrix &y, byte cycles[], byte essential, byte *best=nullptr) {
     perm pi; id_perm(pi);
+    if (best) id_perm(best);
 
     // traverse all nested permutations (orbit) and count stabilizers
     uint64_t stabilizers = 1; // the id is surely a stabilizer
@@ -85,19 +134,184 @@ inline uint64_t explore_orbit(matrix &y, byte cycles[], byte essential) {
         matrix z = permute(y, pi);
         if (z == y)
             stabilizers++;
-        else if (z < smallest)
+        else if (z < smallest) {
             smallest = z;
+            if (best) for (byte i=0; i<N; i++) best[i] = pi[i];
+        }
     }
 
     y = smallest; // set y to the smallest representative
     return stabilizers;
 }
 
-inline uint64_t representative(matrix &y) {
+// Branch-and-bound search for the same result as explore_orbit.
+// The rows of the smallest matrix are fixed from the most significant one (N-1)
+// downwards. Position k gets an index b from its cell. Then row k is smallest if,
+// within each cell below k, the indices with a 1 in row b take the lowest positions,
+// so those cells are split (refined) accordingly. Only the choices of b that give
+// the smallest row k are explored, and a branch is cut as soon as its rows exceed
+// those of the best matrix found so far.
+// A leaf that equals the best matrix, but whose path left the best path at level d,
+// reveals an automorphism: the rest of its subtree at level d mirrors the (explored)
+// subtree of the best path, so the search returns to level d. The number of subtrees
+// at level d that reach the best matrix is the orbit of the best choice under the
+// automorphisms fixing the choices above d, so the stabilizers are the product of
+// these orbit sizes along the best path.
+class OrbitSearch {
+public:
+    static constexpr matrix ROW = (1ULL << N) - 1;
+
+    // Assume y is normalized, with cycles and essential from compute_cycles
+    OrbitSearch(matrix y, const byte cycles[], byte essential):
+            _y(y), _essential(essential), _best(~0ULL), _found(false) {
+        for (byte i=0; i<N; i++) _rows[i] = (y >> N*i) & ROW;
+        perm idx; id_perm(idx);
+        uint32_t bounds = 1U << N; // bit p is set iff a cell starts at position p
+        for (byte i=0; i<essential; i++) bounds |= 1U << i; // inessential indices are fixed
+        for (byte c=0, i=essential; cycles[c]; i += cycles[c++]) bounds |= 1U << i;
+        search(N-1, idx, bounds, 0);
+    }
+
+    matrix smallest() const { return _best; }
+
+    uint64_t stabilizers() const {
+        uint64_t stab = 1;
+        for (byte k=_essential; k<N; k++) stab *= _orbit[k];
+        return stab;
+    }
+
+    // the permutation from y to the smallest matrix
+    void permutation(perm pi) const { for (byte i=0; i<N; i++) pi[i] = _pi[i]; }
+
+private:
+    static constexpr int CONTINUE = -1;
+
+    // idx[p] is the index at position p; rows holds the fixed rows above k.
+    // Returns the level to return to, or CONTINUE
+    int search(int k, const perm idx, uint32_t bounds, matrix rows) {
+        if (k < _essential) // only inessential indices remain
+            return leaf(idx);
+        int start = 31 - __builtin_clz(bounds & ((2U << k) - 1)); // the cell of k
+        perm next[N];
+        uint32_t nextBounds[N];
+        matrix row[N];
+        matrix smallestRow = ~0ULL;
+        for (int p=start; p<=k; p++) {
+            perm &nidx = next[p-start];
+            for (byte i=0; i<N; i++) nidx[i] = idx[i];
+            std::swap(nidx[p], nidx[k]);
+            row[p-start] = refine(k, nidx, nextBounds[p-start] = bounds | 1U << k);
+            smallestRow = std::min(smallestRow, row[p-start]);
+        }
+        rows = (rows << N) | smallestRow;
+        for (int p=start; p<=k; p++)
+            if (row[p-start] == smallestRow && rows <= _best >> N*k) { // _best may have improved
+                int level = search(k-1, next[p-start], nextBounds[p-start], rows);
+                if (level == k) _orbit[k]++; // this subtree also reaches the best matrix
+                else if (level != CONTINUE) return level;
+            }
+        return CONTINUE;
+    }
+
+    int leaf(const perm idx) {
+        matrix z = permute(_y, idx);
+        if (_found && z > _best) return CONTINUE;
+        if (!_found || z < _best) { // a new best path (for N=8, ~0ULL itself can be the best)
+            _found = true;
+            _best = z;
+            for (byte i=0; i<N; i++) {
+                _pi[i] = idx[i];
+                _orbit[i] = 1;
+            }
+            return CONTINUE;
+        }
+        int d = N-1; // the level where this path left the best path
+        while (idx[d] == _pi[d]) d--;
+        return d;
+    }
+
+    // with idx[k] fixed, split the cells below k, and return the smallest row k
+    matrix refine(int k, perm idx, uint32_t &bounds) const {
+        matrix r = _rows[idx[k]];
+        matrix row = 0;
+        for (int j=k; j<N; j++) // fixed positions
+            row |= ((r >> idx[j]) & 1) << j;
+        for (int lo=0; lo<k; ) {
+            int hi = __builtin_ctz(bounds & ~((2U << lo) - 1)); // the next cell starts at hi
+            int ones = lo;
+            for (int j=lo; j<hi; j++) // stable partition: ones first
+                if ((r >> idx[j]) & 1) {
+                    byte b = idx[j];
+                    for (int i=j; i>ones; i--) idx[i] = idx[i-1];
+                    idx[ones++] = b;
+                }
+            row |= ((1ULL << (ones - lo)) - 1) << lo;
+            if (ones > lo && ones < hi) bounds |= 1U << ones;
+            lo = hi;
+        }
+        return row;
+    }
+
+    matrix _y;
+    matrix _rows[N];
+    byte _essential;
+    matrix _best;
+    bool _found;         // _best, _pi and _orbit are set by a leaf
+    perm _pi;            // the best path: the permutation to _best
+    uint64_t _orbit[N];  // orbit sizes along the best path
+};
+
+// orbits with more permutations than this use OrbitSearch instead of explore_orbit
+const uint64_t SEARCH_PERMS = 24;
+
+// the number of permutations that explore_orbit would try
+inline uint64_t orbit_perms(const byte cycles[]) {
+    uint64_t perms = 1;
+    for (byte c=0; cycles[c]; c++) perms *= fac[cycles[c]];
+    return perms;
+}
+
+// the size of the orbit of a matrix with aut automorphisms
+inline uint64_t orbit_size(uint64_t aut) { return fac[N] / aut; }
+
+// Assume y is normalized, with cycles and essential from finger_cycles
+// Set y to its canonical form and return its number of automorphisms
+// (and set pi to the permutation from y to its canonical form, if given)
+inline uint64_t orbit_automorphisms(matrix &y, byte cycles[], byte essential, byte *pi=nullptr) {
+#if NAUTY==2
+    if (orbit_perms(cycles) > NAUTY_PERMS) {
+        HybridStats::Timer timer(hybridStats, HybridStats::NAUTY_CELLS);
+        perm nautyPi;
+        return nauty_cells(y, cycles, essential, pi ? pi : nautyPi);
+    }
+    HybridStats::Timer timer(hybridStats, HybridStats::SEARCH);
+#endif
+    if (orbit_perms(cycles) <= SEARCH_PERMS) { // small cells: enumerating is cheaper
+        uint64_t stab = explore_orbit(y, cycles, essential, pi);
+        return stab * fac[essential];
+    }
+    OrbitSearch search(y, cycles, essential);
+    y = search.smallest();
+    if (pi) search.permutation(pi);
+    return search.stabilizers() * fac[essential];
+}
+
+// set y to its canonical form and return its number of automorphisms
+// finger is the (unsorted) finger-print of y, which will be sorted
+inline uint64_t automorphisms(matrix &y, finger_t finger[N]) {
     byte cycles[N+1];  // cycles for permutation
-    byte essential = compute_cycles(cycles, y); // now y is normalized
-    uint64_t stab = explore_orbit(y, cycles, essential);
-    return fac[N]/(stab * fac[essential]);
+    byte essential = finger_cycles(cycles, y, finger); // now y is normalized
+    return orbit_automorphisms(y, cycles, essential);
+}
+
+inline uint64_t automorphisms(matrix &y) {
+    finger_t finger[N]; // finger print
+    fingerprint(y, finger);
+    return automorphisms(y, finger);
+}
+
+inline uint64_t representative(matrix &y) {
+    return orbit_size(automorphisms(y));
 }
 
 // return the permutation from x to its representative
@@ -108,20 +322,20 @@ void representativePerm(matrix x, perm pi) {
 
     // Similar to representative
     perm pi2;                     // permutation from y to smallest
-    for (byte i=0; i<N; i++) 
-        pi[i] = pi2[i] = i;       // initialize "running" permutation pi
     byte cycles[N+1];             // cycles for permutation
     byte essential = compute_cycles(cycles, y);
-    matrix smallest = y;          // maintain the smallest matrix in the orbit
-    while (next_cycle_perm(cycles, pi + essential)) { // we counted id already
-        matrix z = permute(y, pi);
-        if (z < smallest) {
-            smallest = z;
-            for (byte i=0; i<N; i++) pi2[i]=pi[i];
-        }
+#if NAUTY==2
+    if (orbit_perms(cycles) > NAUTY_PERMS) {
+        nauty_cells(y, cycles, essential, pi2);
+        compose_perm(pi2, pi1, pi);
+        assert(permute(x, pi) == y);
+        return;
     }
+#endif
+    OrbitSearch search(y, cycles, essential);
+    search.permutation(pi2);
     compose_perm(pi2, pi1, pi);
-    assert(permute(x, pi) == smallest);
+    assert(permute(x, pi) == search.smallest());
 }
 
 // Assume that x is normalized
@@ -177,8 +391,7 @@ void investigate(matrix x) {
     pretty_matrix(y);
     byte essential = compute_cycles(cycles, y);
     pretty_cycles(essential, cycles);
-    uint64_t stabilizer = explore_orbit(y, cycles, essential);
-    uint64_t orbits = fac[N]/(stabilizer * fac[essential]);
+    uint64_t orbits = representative(y); // the same method as representativePerm
     printf("Minimized matrix:\n");
     pretty_matrix(y);
     representativePerm(x,pi);
@@ -0,0 +1,190 @@
+#ifndef REPR_H
+#define REPR_H
+
+/*
+ * Jaco van de Pol, Aarhus University, 2025
+ *
+ * Canonical forms under independent row and column permutations (SWAP=1),
+ * without building the 2N-vertex graph for nauty.
+ *
+ * The columns of the canonical form are chosen one by one. The rows are kept in
+ * an ordered partition of cells with equal prefixes (the chosen columns so far).
+ * Choosing column c splits every cell into the rows with a 0 and then those with
+ * a 1 in column c. As a bit vector over the row positions (first position most
+ * significant) column c then has the ones at the end of each cell, and the next
+ * column of the canonical form is the smallest such vector. So only the columns
+ * giving the smallest vector are explored, and a branch is cut as soon as one of
+ * its columns exceeds the column of the best matrix found so far.
+ * An invertible matrix has distinct rows, so the cells end as single rows, and
+ * an automorphism (sigma,tau) is determined by its column permutation tau.
+ * As in OrbitSearch, a leaf that equals the best matrix but left the best path
+ * at level d reveals an automorphism, so the search returns to level d, and the
+ * number of automorphisms is the product of the orbit sizes along the best path.
+ */
+
+#include "matrix.h"
+
+class SwapSearch {
+public:
+    static constexpr matrix ROW = (1ULL << N) - 1;
+
+    SwapSearch(matrix y): _y(y) {
+        for (byte i=0; i<N; i++) {
+            _cols[i] = 0;
+            _bestKey[i] = ~0U;
+        }
+        for (byte i=0; i<N; i++) // column j as a set of rows
+            for (byte j=0; j<N; j++)
+                _cols[j] |= ((y >> (N*i + j)) & 1) << i;
+        perm rows; id_perm(rows);
+        search(0, rows, 1U << N, ROW, false);
+    }
+
+    matrix smallest() const { return permute2(_y, _rows, _col); }
+
+    // the number of pairs (sigma,tau) with (sigma,tau) . y = y
+    uint64_t automorphisms() const {
+        uint64_t aut = 1;
+        for (byte k=0; k<N; k++) aut *= _orbit[k];
+        return aut;
+    }
+
+    // the permutations of the rows and the columns from y to the smallest matrix
+    void permutations(perm pi1, perm pi2) const {
+        for (byte i=0; i<N; i++) {
+            pi1[i] = _rows[i];
+            pi2[i] = _col[i];
+        }
+    }
+
+private:
+    static constexpr int CONTINUE = -1;
+
+    // rows[p] is the row at position p, bounds has bit p set iff a cell starts
+    // at p, and free holds the columns not chosen yet. Choose column position k.
+    // Returns the level to return to, or CONTINUE
+    int search(int k, const perm rows, uint32_t bounds, uint32_t free, bool better) {
+        if (k == N) return leaf(rows, better);
+        uint32_t key[N];
+        uint32_t smallest = ~0U;
+        for (uint32_t f=free; f; f &= f-1) {
+            byte c = __builtin_ctz(f);
+            key[c] = split(rows, bounds, _cols[c]);
+            smallest = std::min(smallest, key[c]);
+        }
+        if (!better) {
+            if (smallest > _bestKey[k]) return CONTINUE;
+            better = smallest < _bestKey[k];
+        }
+        if (better) _bestKey[k] = smallest;
+        for (uint32_t f=free; f; f &= f-1) {
+            byte c = __builtin_ctz(f);
+            if (key[c] != smallest) continue;
+            perm next;
+            uint32_t nextBounds = refine(rows, bounds, _cols[c], next);
+            _path[k] = c;
+            int level = search(k+1, next, nextBounds, free & ~(1U << c), better);
+            better = false; // the next columns have to compete with this subtree
+            if (level == k) _orbit[k]++; // this subtree also reaches the best matrix
+            else if (level != CONTINUE) return level;
+        }
+        return CONTINUE;
+    }
+
+    int leaf(const perm rows, bool better) {
+        if (better) { // a new best path
+            for (byte i=0; i<N; i++) {
+                _rows[i] = rows[i];
+                _col[i] = _path[i];
+                _orbit[i] = 1;
+            }
+            return CONTINUE;
+        }
+        int d = 0; // the level where this path left the best path
+        while (_path[d] == _col[d]) d++;
+        return d;
+    }
+
+    // the column (as a set of rows) at the row positions, once its ones are moved
+    // to the end of every cell; position p is bit N-1-p
+    static uint32_t split(const perm rows, uint32_t bounds, uint32_t col) {
+        uint32_t key = 0;
+        for (int lo=0; lo<N; ) {
+            int hi = __builtin_ctz(bounds & ~((2U << lo) - 1));
+            int ones = 0;
+            for (int p=lo; p<hi; p++) ones += (col >> rows[p]) & 1;
+            key |= ((1U << ones) - 1) << (N - hi);
+            lo = hi;
+        }
+        return key;
+    }
+
+    // split every cell of rows on col (zeros first), into next; return the new bounds
+    static uint32_t refine(const perm rows, uint32_t bounds, uint32_t col, perm next) {
+        uint32_t nextBounds = bounds;
+        for (int lo=0; lo<N; ) {
+            int hi = __builtin_ctz(bounds & ~((2U << lo) - 1));
+            int q = lo;
+            for (int p=lo; p<hi; p++) if (!((col >> rows[p]) & 1)) next[q++] = rows[p];
+            if (q > lo && q < hi) nextBounds |= 1U << q;
+            for (int p=lo; p<hi; p++) if ((col >> rows[p]) & 1) next[q++] = rows[p];
+            lo = hi;
+        }
+        return nextBounds;
+    }
+
+    matrix _y;
+    uint32_t _cols[N];     // the columns of y, as sets of rows
+    uint32_t _bestKey[N];  // the columns of the best matrix, at the row positions
+    perm _path;            // the columns chosen on the current path
+    perm _col;             // the best path: the column permutation to the best matrix
+    perm _rows;            // the row permutation to the best matrix
+    uint64_t _orbit[N];    // orbit sizes along the best path
+};
+
+// the size of the orbit of a matrix with aut automorphisms
+inline uint64_t orbit_size(uint64_t aut) { return fac[N] * fac[N] / aut; }
+
+// set y to its canonical form and return its number of automorphisms
+inline uint64_t automorphisms(matrix &y) {
+    SwapSearch search(y);
+    y = search.smallest();
+    return search.automorphisms();
+}
+
+inline uint64_t representative(matrix &y) {
+    return orbit_size(automorphisms(y));
+}
+
+// return the permutations from x to its representative
+void representativePerm2(matrix x, perm pi1, perm pi2) {
+    SwapSearch search(x);
+    search.permutations(pi1, pi2);
+    assert(permute2(x, pi1, pi2) == search.smallest());
+}
+
+// assuming m1 and m2 are equivalent, find sig, tau such that (sig,tau) . m1 = m2
+void equiv_perm2(matrix m1, matrix m2, perm sig, perm tau) {
+    perm sig1, tau1, sig2, tau2;
+    representativePerm2(m1, sig1, tau1);   // repr = (sig1,tau1) . m1
+    representativePerm2(m2, sig2, tau2);   // repr = (sig2,tau2) . m2
+    compose_inv_perm(sig2, sig1, sig);
+    compose_inv_perm(tau2, tau1, tau);
+    assert(permute2(m1, sig1, tau1) == permute2(m2, sig2, tau2)); // both are repr
+    assert(permute2(m1, sig, tau) == m2);
+}
+
+void investigate(matrix x) {
+    printf("Original matrix:\n");
+    pretty_matrix(x);
+    perm pi1, pi2;
+    representativePerm2(x, pi1, pi2);
+    printf("rows:\n"); pretty_perm(pi1);
+    printf("cols:\n"); pretty_perm(pi2);
+    uint64_t orbit = representative(x);
+    printf("Canonical matrix:\n");
+    pretty_matrix(x);
+    printf("Represents %lu matrices.\n\n",orbit);
+}
+
+#endif
@@ -0,0 +1,109 @@
+/*
+ * Jaco van de Pol, Aarhus University, 2025
+ *
+ * ShardedHashSet: a level set that is split into COUNT independent sets.
+ *
+ * The high bits of a multiplicative hash of the key select its shard, so they
+ * are independent of the (low) bits that the shards themselves use. Every shard
+ * is a separate mapping, so the total capacity is COUNT times the capacity of
+ * a single table, and a growing shard only migrates its own buckets.
+ * With NUMA placement, shard i is placed on node i mod nodes, so the memory of
+ * a level is spread evenly (and predictably) over the nodes, instead of landing
+ * wherever a thread happened to touch it first.
+ */
+
+#pragma once
+
+#include "arena.h"
+
+template<typename SET, size_t COUNT>
+class ShardedHashSet {
+public:
+    static_assert(COUNT > 1 && (COUNT & (COUNT - 1)) == 0, "COUNT should be a power of 2");
+    using TO_TYPE = typename SET::TO_TYPE;
+    static constexpr size_t BITS = __builtin_ctzll(COUNT);
+
+    ShardedHashSet() {}
+
+    // allocate 2^scale buckets in total; other arguments are passed to every shard
+    template<typename... ARGS>
+    ShardedHashSet& init(size_t scale, ARGS... args) {
+        size_t shardScale = std::max<size_t>(scale, BITS + 3) - BITS;
+        for (size_t i=0; i<COUNT; i++) {
+            _shards[i].place(arena.node(i));
+            _shards[i].init(shardScale, args...);
+        }
+        return *this;
+    }
+
+    void deinit() {
+        for (size_t i=0; i<COUNT; i++) _shards[i].deinit();
+    }
+
+    ShardedHashSet& operator=(const ShardedHashSet& other) = delete;
+
+    ShardedHashSet& operator=(ShardedHashSet&& other) {
+        for (size_t i=0; i<COUNT; i++) _shards[i] = std::move(other._shards[i]);
+        return *this;
+    }
+
+    void reclaim() {
+        for (size_t i=0; i<COUNT; i++) _shards[i].reclaim();
+    }
+
+    void order() {
+        for (size_t i=0; i<COUNT; i++) _shards[i].order();
+    }
+
+    __attribute__((always_inline))
+    bool insert(uint64_t key) { return shard(key).insert(key); }
+
+    __attribute__((always_inline))
+    bool insert(uint64_t key, uint64_t bits) { return shard(key).insert(key, bits); }
+
+    __attribute__((always_inline))
+    TO_TYPE contains(uint64_t key) { return shard(key).contains(key); }
+
+    __attribute__((always_inline))
+    void prefetch(uint64_t key) const { shard(key).prefetch(key); }
+
+    void stats() {
+        for (size_t i=0; i<COUNT; i++) {
+            printf("...shard %ld (node %d): ", i, arena.node(i));
+            _shards[i].stats();
+        }
+    }
+
+    void statistics(bool verbose=false) {
+        for (size_t i=0; i<COUNT; i++) _shards[i].statistics(verbose);
+    }
+
+    template<typename FUNC>
+    void forAll(FUNC&& func) {
+        for (size_t i=0; i<COUNT; i++) _shards[i].forAll(func);
+    }
+
+    // every shard is visited by all threads in turn
+    template<typename FUNC>
+    void parallelForAll(FUNC&& func) {
+        for (size_t i=0; i<COUNT; i++) _shards[i].parallelForAll(func);
+    }
+
+    template<typename FUNC>
+    void parallelForAllMasked(FUNC&& func) {
+        for (size_t i=0; i<COUNT; i++) _shards[i].parallelForAllMasked(func);
+    }
+
+private:
+    static size_t index(uint64_t key) {
+        return (key * 0x9e3779b97f4a7c15ULL) >> (64 - BITS);
+    }
+
+    __attribute__((always_inline))
+    SET& shard(uint64_t key) { return _shards[index(key)]; }
+
+    __attribute__((always_inline))
+    const SET& shard(uint64_t key) const { return _shards[index(key)]; }
+
+    SET _shards[COUNT];
+};
@@ -17,7 +17,32 @@ uint64_t currentTime() {
 void report(uint64_t level, uint64_t orbit) {
     std::cout   << std::setprecision(std::numeric_limits<double>::digits10)
                 << "(" << currentTime() << "s) ("
-                << level << " elts) (" << orbit << " orbits)" << std::endl;
+                << level << " elts) (" << orbit << " orbits)";
+#if ARENA==1 // time to map and clear tables, and memory reused from earlier tables
+    std::cout   << std::setprecision(2) << std::fixed
+                << " (arena: " << arena.takeSeconds() << "s, "
+                << (arena.takeRecycled() >> 20) << " MB recycled)" << std::defaultfloat;
+#endif
+#if CACHE>0 // canonical forms found in the cache, and computed
+    auto [hits, misses] = canonCache.take();
+    std::cout   << std::setprecision(1) << std::fixed
+                << " (cache: " << hits << " hits, " << misses << " misses, "
+                << (hits + misses ? 100.0 * hits / (hits + misses) : 0.0) << "%)" << std::defaultfloat;
+#endif
+#if NAUTY==2 // matrices canonicalized by permutation search and by nauty, and their time
+    auto [searched, searchSeconds] = hybridStats.take(HybridStats::SEARCH);
+    auto [nautied, nautySeconds] = hybridStats.take(HybridStats::NAUTY_CELLS);
+    std::cout   << std::setprecision(2) << std::fixed
+                << " (search: " << searched << " in " << searchSeconds << "s, nauty: "
+                << nautied << " in " << nautySeconds << "s)" << std::defaultfloat;
+#endif
+#if BACK==1 // moves skipped since they lead back into the previous level, and moves canonicalized
+    auto [skipped, expanded] = backStats.take();
+    std::cout   << std::setprecision(1) << std::fixed
+                << " (back: " << skipped << " skipped, " << expanded << " canonicalized, "
+                << (skipped + expanded ? 100.0 * skipped / (skipped + expanded) : 0.0) << "%)" << std::defaultfloat;
+#endif
+    std::cout   << std::endl;
 }
 
 void lifeBeat(int worker, uint64_t level, uint64_t orbit) {
@@ -4,17 +4,62 @@
 #include "matrix.h"
 #include "repr.h"
 #include "hashset.h"
+#include "frozenset.h"
+#include "visited.h"
+#include "sharded.h"
+#include "filter.h"
+#if BACK==1
+#include "backmoves.h"
+#endif
 #include <vector>
 
 using trace = std::vector<std::pair<byte,byte>>;
-using hashset = HashSet<uint64_t, Linear, MurmurHash>;
+#if GLOBAL==1
+using hashset = VisitedLevel<GrowingHashSet<TaggedHashSet<N*N>>, N*N>;
+#else
+#if COMPACT==1
+using table = CompactHashSet<N*N>;
+#elif SWISS==1
+using table = SwissHashSet;
+#elif BACK==1
+using table = MaskedHashSet<N*N>;
+#else
+using table = HashSet<uint64_t, Linear, MurmurHash>;
+#endif
+#if GROW==1
+using liveset = GrowingHashSet<table>;
+#else
+using liveset = table;
+#endif
+#if SHARDS>1
+using shardset = ShardedHashSet<liveset, SHARDS>;
+#else
+using shardset = liveset;
+#endif
+#if FREEZE==1
+using levelset = FreezingSet<shardset>;
+#else
+using levelset = shardset;
+#endif
+#if FILTER>0
+using hashset = Filtered<levelset>;
+#else
+using hashset = levelset;
+#endif
+#endif
 
-inline bool find_level(matrix m, hashset &level) {
-    representative(m);
+// the level holds canonical forms in the larger group with inverse and transpose if dual
+inline bool find_level(matrix m, hashset &level, bool dual) {
+#if INVERSE>=1
+    if (dual) dual_canonical(m);
+    else
+#endif
+    canonical(m);
     return level.contains(m);
 }
 
-matrix step_back(matrix x, hashset &level, trace &tr) {
+// the row operations suffice also if dual: a predecessor of x is one of its row operations
+matrix step_back(matrix x, hashset &level, trace &tr, bool dual) {
     matrix mask = (1 << N) - 1; // to select row i
     for (byte i=0; i<N; i++) {
         matrix row = (x & mask) >> N*i;
@@ -22,7 +67,7 @@ matrix step_back(matrix x, hashset &level, trace &tr) {
         for (byte j=0; j<N; j++, row <<= N) // add to row j
             if (i != j) {
                 matrix prev = x ^ row; 
-                if (find_level(prev, level)) {
+                if (find_level(prev, level, dual)) {
                     tr.push_back(std::pair<byte,byte>(i,j));
                     return prev;
     }   }       }
@@ -30,9 +75,9 @@ matrix step_back(matrix x, hashset &level, trace &tr) {
     exit(-1);
 }
 
-matrix trace_back(matrix goal, hashset levels[], int depth, trace &tr) {
+matrix trace_back(matrix goal, hashset levels[], int depth, trace &tr, bool dual) {
     for (int d=depth - 1; d>0; d--)
-        goal = step_back(goal, levels[d], tr);
+        goal = step_back(goal, levels[d], tr, dual);
     return goal;
 }
 
@@ -49,8 +94,8 @@ trace permute_trace(const perm pi, const trace &tr) {
 trace trace_back_middle(matrix id, matrix middle, matrix goal, hashset bfs_fwd[], hashset bfs_bwd[], int fdepth, int bdepth, perm pi) {
     trace fwd_trace, bwd_trace, result;
     matrix id_found, goal_found;
-    id_found = trace_back(middle, bfs_fwd, fdepth, fwd_trace);
-    goal_found = trace_back(middle, bfs_bwd, bdepth, bwd_trace);
+    id_found = trace_back(middle, bfs_fwd, fdepth, fwd_trace, INVERSE>=1);
+    goal_found = trace_back(middle, bfs_bwd, bdepth, bwd_trace, false);
 
     // REVERSE the forward trace and concatenate backward trace
     std::reverse(fwd_trace.begin(),fwd_trace.end());
@@ -87,6 +132,37 @@ trace trace_back_middle(matrix id, matrix middle, matrix goal, hashset bfs_fwd[]
     return result;
 }
 
+#if INVERSE>=1
+// map a trace of dual(x, v) to a trace of x: a circuit for x^-1 is reversed, and a
+// circuit for x^T is reversed with controls and targets swapped (x^-T: only swapped)
+trace dual_trace(const trace &tr, byte v) {
+    trace result(tr);
+    if ((v & 1) != (v >> 1))
+        std::reverse(result.begin(), result.end());
+    if (v & 2)
+        for (auto &pair : result)
+            std::swap(pair.first, pair.second);
+    return result;
+}
+
+// the variant of goal to search backward from: the fewest orbits of successors (x and
+// x^-T search the same number of matrices, x^-1 and x^T may differ by the overlaps
+// between the searches from the permutations of x)
+byte dual_goal(matrix goal) {
+    byte best = 0;
+    size_t fewest = SIZE_MAX;
+    for (byte v=0; v<4; v++) {
+        matrix succ[MOVES];
+        uint64_t aut[MOVES];
+        size_t size = canonical_successors(Parent(dual(goal, v)), succ, aut);
+        std::sort(succ, succ + size);
+        size = std::unique(succ, succ + size) - succ;
+        if (size < fewest) { fewest = size; best = v; }
+    }
+    return best;
+}
+#endif
+
 void print_trace(matrix m, matrix goal, const trace &tr, perm pi) {
     printf("\nOPENQASM 2.0;\n");
     printf("include \"qelib1.inc\";\n");
@@ -0,0 +1,180 @@
+/*
+ * Jaco van de Pol, Aarhus University, 2025
+ *
+ * A single table with all visited matrices, tagged with their BFS depth.
+ *
+ * A matrix on N<=7 qubits uses at most 49 bits, so the remaining high bits
+ * of a bucket can store its depth. A VisitedLevel is a view on the shared
+ * table, containing only the matrices with its own depth. Inserting a matrix
+ * that was already visited (at any depth) fails, so a successor needs only
+ * one probe sequence, instead of one each for prev, current and next.
+ * Since the table grows while the next level is inserted, the current level
+ * is first collected into a frontier array before it is expanded.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <omp.h>
+#include "hashset.h"
+
+// A HashSet of keys with KEYBITS bits that carry a tag in the remaining high bits.
+// Keys are hashed and compared without their tag; the first inserted tag stays.
+template<size_t KEYBITS>
+class TaggedHashSet : public HashSet<uint64_t, Linear, MurmurHash> {
+public:
+    static_assert(KEYBITS < 64, "no room for a tag");
+    static constexpr uint64_t KEYMASK = (1ULL << KEYBITS) - 1;
+
+    static uint64_t tag(uint64_t word) { return word >> KEYBITS; }
+
+    static uint64_t key(uint64_t word) { return word & KEYMASK; }
+
+    // word is a key with its tag; for lookups the tag is ignored
+    template<int INSERT>
+    TO_TYPE insertOrContains(uint64_t word, bool &is_new) {
+        assert(_map && "storage not initialized");
+        uint64_t k0 = key(word);
+        assert(k0 && "cannot store 0");
+        TO_TYPE e = entry(k0);
+        e += e == 0;
+        Bucketfinder searcher(*this, e);
+        std::atomic<uint64_t>* current = &_map[e];
+
+        size_t probeCount = 1;
+
+        while(probeCount < _buckets) {
+            uint64_t k = current->load(std::memory_order_relaxed);
+            if(k == 0ULL) {
+                if(e == 0) goto findnext;
+                if (!INSERT) {
+                    return 0;
+                }
+                if(current->compare_exchange_strong(k, word, std::memory_order_release, std::memory_order_relaxed)) {
+                    is_new = true;
+                    return e;
+                }
+            }
+            if(k == MOVED) {
+                is_new = false;
+                return _buckets;
+            }
+            if(key(k) == k0) {
+                is_new = false;
+                return e;
+            }
+            findnext:
+            searcher.next();
+            current = &_map[e];
+            probeCount++;
+        }
+        printf("Hash map full! (2^%ld=%ld buckets)\n",_scale,_buckets);
+        exit(-1);
+    }
+
+    __attribute__((always_inline))
+    bool insert(uint64_t word) {
+        bool is_new;
+        insertOrContains<1>(word, is_new);
+        return is_new;
+    }
+
+    __attribute__((always_inline))
+    TO_TYPE contains(uint64_t key) {
+        bool dummy;
+        return insertOrContains<0>(key, dummy);
+    }
+
+    // Move the tagged keys in buckets [lo,hi) to the (larger) table to, leaving MOVED behind.
+    void migrate(size_t lo, size_t hi, TaggedHashSet& to) {
+        for (size_t i=lo; i<hi; i++) {
+            uint64_t k = _map[i].exchange(MOVED, std::memory_order_acq_rel);
+            if (k) to.insert(k);
+        }
+    }
+};
+
+// A BFS level: the matrices with depth _depth in a table shared with all other levels
+template<typename TABLE, size_t KEYBITS>
+class VisitedLevel {
+public:
+    using TO_TYPE = typename TABLE::TO_TYPE;
+    using Tagged = TaggedHashSet<KEYBITS>;
+
+    VisitedLevel(): _depth(0) {}
+
+    // start a new shared table, with this level at depth 0
+    template<typename... ARGS>
+    VisitedLevel& init(ARGS... args) {
+        _table = std::make_shared<TABLE>();
+        _table->init(args...);
+        _depth = 0;
+        return *this;
+    }
+
+    // become the level at depth, sharing the table of other
+    VisitedLevel& attach(const VisitedLevel& other, uint64_t depth) {
+        _table = other._table;
+        _depth = depth;
+        return *this;
+    }
+
+    // The table itself is released with the last level that uses it
+    void deinit() { _table.reset(); }
+
+    void reclaim() { _table->reclaim(); }
+
+    // only succeeds if key has not been visited before, at any depth
+    __attribute__((always_inline))
+    bool insert(uint64_t key) {
+        return _table->insert(key | _depth << KEYBITS);
+    }
+
+    __attribute__((always_inline))
+    void prefetch(uint64_t key) const { _table->prefetch(key); }
+
+    __attribute__((always_inline))
+    TO_TYPE contains(uint64_t key) {
+        TO_TYPE e = _table->contains(key);
+        return e && Tagged::tag(_table->get(e)) == _depth ? e : 0;
+    }
+
+    void stats() { _table->stats(); }
+
+    // NOTE: this scans the buckets of all levels
+    template<typename FUNC>
+    void forAll(FUNC&& func) {
+        _table->forAll([&](uint64_t word) {
+            if (Tagged::tag(word) == _depth) func(Tagged::key(word));
+        });
+    }
+
+    // func may insert into the shared table, which can then migrate under the scan,
+    // so the keys of this level are collected before func is called on them
+    template<typename FUNC>
+    void parallelForAll(FUNC&& func) {
+        int threads = omp_get_max_threads();
+        std::vector<std::vector<uint64_t>> local(threads);
+        _table->parallelForAll([&](uint64_t word) {
+            if (Tagged::tag(word) == _depth)
+                local[omp_get_thread_num()].push_back(Tagged::key(word));
+        });
+        std::vector<uint64_t> offset(threads + 1, 0);
+        for (int t=0; t<threads; t++)
+            offset[t+1] = offset[t] + local[t].size();
+        std::vector<uint64_t> keys(offset[threads]);
+        #pragma omp parallel for
+        for (int t=0; t<threads; t++) {
+            std::copy(local[t].begin(), local[t].end(), keys.begin() + offset[t]);
+            std::vector<uint64_t>().swap(local[t]);
+        }
+        #pragma omp parallel for schedule(dynamic, 1024)
+        for (size_t i=0; i<keys.size(); i++)
+            func(keys[i]);
+    }
+
+private:
+    std::shared_ptr<TABLE> _table;
+    uint64_t _depth;
+};